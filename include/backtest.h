@@ -0,0 +1,155 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+#include "orderBook.h"
+#include "randomFlow.h"
+
+// One random-flow simulation on its own OrderBook, for parameter sweeps: the benchmark's
+// RandomFlow with the market-shape knobs exposed. Everything but the timing follows from the
+// scenario and its seed, so a run gives the same result on any thread.
+struct BacktestScenario : FlowProfile {
+    std::uint64_t numOps = 1'000'000ULL;
+    std::uint64_t seed = 1;
+    // The book's top levels are sampled every this many ops for the spread and depth profile.
+    std::uint64_t sampleEvery = 1000;
+};
+
+inline constexpr std::size_t kBacktestDepthLevels = 10;
+
+struct BacktestResult {
+    std::uint64_t adds = 0;
+    std::uint64_t cancels = 0;
+    std::uint64_t modifies = 0;
+    std::uint64_t trades = 0;
+    Quantity tradedVolume = 0;
+    std::size_t finalRestingOrders = 0;
+    std::size_t finalBidLevels = 0;
+    std::size_t finalAskLevels = 0;
+    // Over the samples with both sides present.
+    std::uint64_t twoSidedSamples = 0;
+    double meanSpread = 0.0;
+    // Mean volume at the k-th best level over all samples (0 where a side was shorter).
+    std::array<double, kBacktestDepthLevels> bidDepth{};
+    std::array<double, kBacktestDepthLevels> askDepth{};
+    // Hash of every trade in order and of the final book; equal across runs of one scenario.
+    std::uint64_t digest = 0;
+    double seconds = 0.0;
+
+    double opsPerSec() const { return seconds > 0.0 ? static_cast<double>(adds + cancels + modifies) / seconds : 0.0; }
+};
+
+namespace backtest_detail {
+    inline void mix(std::uint64_t& digest, std::uint64_t value) {
+        digest = (digest ^ value) * 0x100000001B3ULL;
+        digest ^= digest >> 29;
+    }
+}
+
+inline BacktestResult runBacktest(const BacktestScenario& scenario) {
+    using Clock = std::chrono::steady_clock;
+    using backtest_detail::mix;
+
+    // Every price the flow can produce sits inside the dense band.
+    const Price lowest = std::min(scenario.centerPrice - scenario.spreadHalf - scenario.bandWidth, scenario.centerPrice - scenario.modifyRange);
+    const Price highest = std::max(scenario.centerPrice + scenario.spreadHalf + scenario.bandWidth, scenario.centerPrice + scenario.modifyRange);
+    const OrderBookConfig config{
+        .ladderBase = std::max<Price>(0, lowest),
+        .ladderTicks = static_cast<std::size_t>(highest - std::max<Price>(0, lowest) + 1),
+        .orderCapacity = scenario.maxTrackedOrders,
+    };
+    OrderBook book(config);
+    RandomFlow flow(scenario, scenario.seed);
+
+    BacktestResult result;
+    result.digest = 0xCBF29CE484222325ULL;
+    auto onTrade = [&result](const Trade& trade) {
+        ++result.trades;
+        result.tradedVolume += trade.quantity;
+        mix(result.digest, trade.buyOrderId);
+        mix(result.digest, trade.sellOrderId);
+        mix(result.digest, static_cast<std::uint64_t>(trade.price));
+        mix(result.digest, trade.quantity);
+    };
+
+    std::array<Quantity, kBacktestDepthLevels> bidSums{};
+    std::array<Quantity, kBacktestDepthLevels> askSums{};
+    std::uint64_t samples = 0;
+    Price spreadSum = 0;
+    auto sample = [&]() {
+        ++samples;
+        auto accumulate = [&](Side side, std::array<Quantity, kBacktestDepthLevels>& sums) {
+            std::size_t level = 0;
+            book.forEachLevel(side, [&](Price, Quantity volume) {
+                sums[level++] += volume;
+                return level < kBacktestDepthLevels;
+            });
+        };
+        accumulate(Side::BUY, bidSums);
+        accumulate(Side::SELL, askSums);
+        if (const auto spread = book.getSpread()) {
+            ++result.twoSidedSamples;
+            spreadSum += *spread;
+        }
+    };
+
+    for (std::uint64_t i = 0; flow.wantsPrefill(i); ++i) {
+        Order order = flow.nextPrefill(i);
+        const OrderResult added = book.addOrder(order, onTrade);
+        flow.onAdded(order, added);
+    }
+
+    const auto start = Clock::now();
+    for (std::uint64_t i = 0; i < scenario.numOps; ++i) {
+        if (scenario.sampleEvery && i % scenario.sampleEvery == 0) sample();
+
+        switch (flow.nextAction()) {
+        case FlowAction::ADD: {
+            Order order = flow.nextAdd();
+            const OrderResult added = book.addOrder(order, onTrade);
+            flow.onAdded(order, added);
+            ++result.adds;
+            break;
+        }
+        case FlowAction::CANCEL:
+            if (const std::optional<std::size_t> idx = flow.nextCancel()) {
+                book.cancelOrder(flow.getTracked(*idx).id);
+                flow.onCancelled(*idx);
+                ++result.cancels;
+            }
+            break;
+        case FlowAction::MODIFY:
+            if (const std::optional<FlowModify> step = flow.nextModify()) {
+                flow.onModified(*step, book.modifyOrder(step->modify, onTrade).resting);
+                ++result.modifies;
+            }
+            break;
+        }
+    }
+    result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    result.finalRestingOrders = book.getOrderCount();
+    auto finish = [&](Side side, std::size_t& levels) {
+        book.forEachLevel(side, [&](Price price, Quantity volume) {
+            ++levels;
+            mix(result.digest, static_cast<std::uint64_t>(price));
+            mix(result.digest, volume);
+            return true;
+        });
+    };
+    finish(Side::BUY, result.finalBidLevels);
+    finish(Side::SELL, result.finalAskLevels);
+
+    if (samples > 0) {
+        for (std::size_t level = 0; level < kBacktestDepthLevels; ++level) {
+            result.bidDepth[level] = static_cast<double>(bidSums[level]) / static_cast<double>(samples);
+            result.askDepth[level] = static_cast<double>(askSums[level]) / static_cast<double>(samples);
+        }
+    }
+    if (result.twoSidedSamples > 0) result.meanSpread = static_cast<double>(spreadSum) / static_cast<double>(result.twoSidedSamples);
+    return result;
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <span>
+
+#include "orderBook.h"
+
+// Fixed-size record for one inbound book command, for queues, batches and files.
+// Carries the Order fields for adds (stopPrice only matters for stop orders), the OrderModify
+// fields for modifies and just the id for cancels.
+enum class CommandType : std::uint8_t { ADD, CANCEL, MODIFY };
+
+struct Command {
+    CommandType type;
+    Side side;
+    OrderType orderType;
+    TimeInForce tif;
+    OrderId id;
+    Price price;
+    Quantity quantity;
+    Price stopPrice = 0;
+
+    static Command add(const Order& order) {
+        return Command{ CommandType::ADD, order.side, order.type, order.tif, order.id, order.price, order.getRemainingQuantity(), order.stopPrice };
+    }
+
+    static Command cancel(OrderId id) {
+        return Command{ CommandType::CANCEL, Side::BUY, OrderType::LIMIT, TimeInForce::GTC, id, 0, 0 };
+    }
+
+    static Command modify(const OrderModify& modify) {
+        return Command{ CommandType::MODIFY, Side::BUY, OrderType::LIMIT, TimeInForce::GTC, modify.id_, modify.price_, modify.quantity_ };
+    }
+
+    Order toOrder() const { return Order(id, side, orderType, price, quantity, tif, stopPrice); }
+    OrderModify toModify() const { return OrderModify{ id, price, quantity }; }
+};
+
+// Applies one command to the book, streaming fills into sink, and reports what it did.
+template <typename Policy, TradeSink Sink>
+OrderResult applyCommand(BasicOrderBook<Policy>& book, const Command& command, Sink&& sink) noexcept {
+    switch (command.type) {
+    case CommandType::ADD: {
+        Order order = command.toOrder();
+        return book.addOrder(order, sink);
+    }
+    case CommandType::CANCEL:
+        return book.cancelOrder(command.id);
+    case CommandType::MODIFY:
+        return book.modifyOrder(command.toModify(), sink);
+    }
+    return OrderResult::rejected(RejectReason::UNSUPPORTED);
+}
+
+// Commands processBatch looks ahead: index slots are prefetched this far ahead, and the
+// resting orders they point at half as far, once those slots should be in cache.
+inline constexpr std::size_t kBatchPrefetchDistance = 16;
+
+// Applies commands in order with exactly the effects, fills and level updates of one
+// applyCommand call each, but prefetches the id-index slots and resting orders of the
+// commands coming up so their cache misses overlap with the work on the current one.
+// Each command's OrderResult goes to the same position in results, as far as results reaches
+// (pass an empty span to drop them). Returns how many commands were accepted.
+template <typename Policy, TradeSink Sink>
+std::size_t processBatch(BasicOrderBook<Policy>& book, std::span<const Command> commands, Sink&& sink,
+    std::span<OrderResult> results = {}) noexcept {
+    constexpr std::size_t kIndexAhead = kBatchPrefetchDistance;
+    constexpr std::size_t kOrderAhead = kBatchPrefetchDistance / 2;
+
+    const std::size_t count = commands.size();
+    for (std::size_t i = 0; i < std::min(kIndexAhead, count); ++i) book.prefetchIndex(commands[i].id);
+    for (std::size_t i = 0; i < std::min(kOrderAhead, count); ++i) {
+        if (commands[i].type != CommandType::ADD) book.prefetchOrder(commands[i].id);
+    }
+
+    std::size_t applied = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        if (i + kIndexAhead < count) book.prefetchIndex(commands[i + kIndexAhead].id);
+        if (i + kOrderAhead < count && commands[i + kOrderAhead].type != CommandType::ADD) {
+            book.prefetchOrder(commands[i + kOrderAhead].id);
+        }
+
+        const OrderResult result = applyCommand(book, commands[i], sink);
+        applied += result.accepted() ? 1 : 0;
+        if (i < results.size()) results[i] = result;
+    }
+    return applied;
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <span>
+#include <vector>
+
+#include "orderBook.h"
+
+// Consumer-side copy of the book's L2 depth, kept current from LevelUpdate batches.
+// Each batch costs O(changes * log M); reading the top N levels never touches the book.
+class DepthMirror {
+public:
+    void apply(std::span<const LevelUpdate> updates) {
+        for (const LevelUpdate& update : updates) {
+            if (update.side == Side::BUY) applyTo(bids_, update);
+            else applyTo(asks_, update);
+        }
+    }
+
+    LevelUpdateHandler handler() {
+        return [this](std::span<const LevelUpdate> updates) { apply(updates); };
+    }
+
+    std::vector<OrderBook::BookLevel> getBidDepth(std::size_t levels) const { return depthFrom(bids_, levels); }
+    std::vector<OrderBook::BookLevel> getAskDepth(std::size_t levels) const { return depthFrom(asks_, levels); }
+
+    std::size_t getBidLevelCount() const { return bids_.size(); }
+    std::size_t getAskLevelCount() const { return asks_.size(); }
+
+private:
+    std::map<Price, Quantity, std::greater<Price>> bids_;
+    std::map<Price, Quantity> asks_;
+
+    template <typename Levels>
+    static void applyTo(Levels& levels, const LevelUpdate& update) {
+        if (update.action == LevelAction::REMOVE) levels.erase(update.price);
+        else levels[update.price] = update.volume;
+    }
+
+    template <typename Levels>
+    static std::vector<OrderBook::BookLevel> depthFrom(const Levels& levels, std::size_t count) {
+        std::vector<OrderBook::BookLevel> depth;
+        depth.reserve(std::min(count, levels.size()));
+        for (auto it = levels.begin(); count > 0 && it != levels.end(); --count, ++it) {
+            depth.emplace_back(it->first, it->second);
+        }
+        return depth;
+    }
+};
@@ -0,0 +1,140 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include "depthMirror.h"
+#include "marketDataRing.h"
+
+// A consumer's copy of the book, rebuilt from MarketDataRecords. ORDER records maintain every
+// resting order (market by order) and the level volumes they add up to; LEVEL records maintain
+// a DepthMirror of the L2 feed. Applying a whole command's records makes the two agree, so a
+// reader can check itself with matchesLevels(). Records for orders it has never seen (it
+// joined late, or was overrun) are counted and otherwise ignored.
+class FeedBook {
+public:
+    struct RestingOrder {
+        Side side;
+        Price price;
+        Quantity remaining;
+    };
+
+    void apply(const MarketDataRecord& record) {
+        ++records_;
+        if (record.type == MarketDataType::LEVEL) {
+            const LevelUpdate update{ record.price, record.quantity, record.side, record.levelAction() };
+            levels_.apply(std::span<const LevelUpdate>(&update, 1));
+            return;
+        }
+        if (record.type != MarketDataType::ORDER) return;
+
+        switch (record.orderAction()) {
+        case OrderEventAction::ADD:
+            orders_[record.id] = RestingOrder{ record.side, record.price, record.quantity };
+            addVolume(record.side, record.price, record.quantity);
+            break;
+        case OrderEventAction::REDUCE:
+            if (RestingOrder* order = find(record.id)) {
+                removeVolume(order->side, order->price, order->remaining - record.quantity);
+                order->remaining = record.quantity;
+            }
+            break;
+        case OrderEventAction::REMOVE:
+            if (RestingOrder* order = find(record.id)) {
+                removeVolume(order->side, order->price, order->remaining);
+                orders_.erase(record.id);
+            }
+            break;
+        case OrderEventAction::FILL:
+            ++trades_;
+            tradedVolume_ += record.quantity;
+            lastTradePrice_ = record.price;
+            if (RestingOrder* order = find(record.id)) {
+                removeVolume(order->side, order->price, record.quantity);
+                order->remaining -= record.quantity;
+                if (order->remaining == 0) orders_.erase(record.id);
+            }
+            break;
+        case OrderEventAction::CLEAR:
+            orders_.clear();
+            bids_.clear();
+            asks_.clear();
+            break;
+        }
+    }
+
+    std::size_t getOrderCount() const { return orders_.size(); }
+    const RestingOrder* getOrder(OrderId id) const {
+        const auto it = orders_.find(id);
+        return it == orders_.end() ? nullptr : &it->second;
+    }
+
+    // Depth summed from the individual orders, and as the L2 feed reported it.
+    std::vector<OrderBook::BookLevel> getBidDepth(std::size_t levels) const { return depthFrom(bids_, levels); }
+    std::vector<OrderBook::BookLevel> getAskDepth(std::size_t levels) const { return depthFrom(asks_, levels); }
+    const DepthMirror& getLevelFeed() const { return levels_; }
+
+    // True when the order-by-order depth equals the L2 feed's at every level.
+    bool matchesLevels() const {
+        auto same = [](const std::vector<OrderBook::BookLevel>& lhs, const std::vector<OrderBook::BookLevel>& rhs) {
+            return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(),
+                [](const auto& a, const auto& b) { return a.price == b.price && a.volume == b.volume; });
+        };
+        return same(getBidDepth(bids_.size()), levels_.getBidDepth(levels_.getBidLevelCount()))
+            && same(getAskDepth(asks_.size()), levels_.getAskDepth(levels_.getAskLevelCount()));
+    }
+
+    std::uint64_t getRecordCount() const { return records_; }
+    std::uint64_t getTradeCount() const { return trades_; }
+    Quantity getTradedVolume() const { return tradedVolume_; }
+    std::optional<Price> getLastTradePrice() const { return lastTradePrice_; }
+    std::uint64_t getUnknownOrderRecords() const { return unknown_; }
+
+private:
+    std::unordered_map<OrderId, RestingOrder> orders_;
+    std::map<Price, Quantity, std::greater<Price>> bids_;
+    std::map<Price, Quantity> asks_;
+    DepthMirror levels_;
+    std::uint64_t records_ = 0;
+    std::uint64_t trades_ = 0;
+    Quantity tradedVolume_ = 0;
+    std::optional<Price> lastTradePrice_;
+    std::uint64_t unknown_ = 0;
+
+    RestingOrder* find(OrderId id) {
+        const auto it = orders_.find(id);
+        if (it != orders_.end()) return &it->second;
+        ++unknown_;
+        return nullptr;
+    }
+
+    void addVolume(Side side, Price price, Quantity quantity) {
+        if (side == Side::BUY) bids_[price] += quantity;
+        else asks_[price] += quantity;
+    }
+
+    void removeVolume(Side side, Price price, Quantity quantity) {
+        auto take = [&](auto& levels) {
+            const auto it = levels.find(price);
+            if (it == levels.end()) return;
+            it->second -= quantity;
+            if (it->second == 0) levels.erase(it);
+        };
+        if (side == Side::BUY) take(bids_);
+        else take(asks_);
+    }
+
+    template <typename Levels>
+    static std::vector<OrderBook::BookLevel> depthFrom(const Levels& levels, std::size_t count) {
+        std::vector<OrderBook::BookLevel> depth;
+        depth.reserve(std::min(count, levels.size()));
+        for (auto it = levels.begin(); count > 0 && it != levels.end(); --count, ++it) depth.emplace_back(it->first, it->second);
+        return depth;
+    }
+};
@@ -0,0 +1,46 @@
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Binary indexed (Fenwick) tree of unsigned sums over slots [0, size): point updates, prefix
+// sums and "how far until the sum exceeds X" are all O(log size). Decreases are added as the
+// wrapped negative (0 - amount), which is exact as long as every true prefix sum is non-negative.
+class FenwickTree {
+public:
+    FenwickTree() = default;
+    explicit FenwickTree(std::size_t size) : tree_(size + 1, 0) {}
+
+    std::size_t size() const { return tree_.empty() ? 0 : tree_.size() - 1; }
+
+    void add(std::size_t slot, std::uint64_t delta) {
+        for (std::size_t i = slot + 1; i < tree_.size(); i += i & (0 - i)) tree_[i] += delta;
+    }
+
+    void clear() { std::fill(tree_.begin(), tree_.end(), 0); }
+
+    // Sum of slots [0, count).
+    std::uint64_t prefix(std::size_t count) const {
+        std::uint64_t sum = 0;
+        for (std::size_t i = count; i > 0; i &= i - 1) sum += tree_[i];
+        return sum;
+    }
+
+    // Largest count with prefix(count) <= limit.
+    std::size_t countWithin(std::uint64_t limit) const {
+        std::size_t count = 0;
+        for (std::size_t step = std::bit_floor(size()); step > 0; step >>= 1) {
+            const std::size_t next = count + step;
+            if (next < tree_.size() && tree_[next] <= limit) {
+                count = next;
+                limit -= tree_[next];
+            }
+        }
+        return count;
+    }
+
+private:
+    std::vector<std::uint64_t> tree_; // 1-based; tree_[0] unused
+};
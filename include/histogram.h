@@ -0,0 +1,123 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <x86intrin.h>
+#endif
+
+// Log-linear (HDR-style) histogram of non-negative integers: exact below 64, then 32 linear
+// sub-buckets per power of two, so any recorded value is reported within ~3%. Recording is
+// a bit scan and an increment; the whole table is fixed size and never allocates.
+class Histogram {
+public:
+    void record(std::uint64_t value) {
+        ++counts_[indexOf(value)];
+        ++count_;
+        sum_ += value;
+        min_ = std::min(min_, value);
+        max_ = std::max(max_, value);
+    }
+
+    void merge(const Histogram& other) {
+        for (std::size_t i = 0; i < kBuckets; ++i) counts_[i] += other.counts_[i];
+        count_ += other.count_;
+        sum_ += other.sum_;
+        min_ = std::min(min_, other.min_);
+        max_ = std::max(max_, other.max_);
+    }
+
+    void reset() { *this = Histogram{}; }
+
+    std::uint64_t count() const { return count_; }
+    std::uint64_t min() const { return count_ ? min_ : 0; }
+    std::uint64_t max() const { return max_; }
+    double mean() const { return count_ ? static_cast<double>(sum_) / static_cast<double>(count_) : 0.0; }
+
+    // Smallest bucket bound covering fraction q (0..1) of the samples, clamped to the max seen.
+    std::uint64_t percentile(double q) const {
+        if (count_ == 0) return 0;
+        const double wanted = q * static_cast<double>(count_);
+        std::uint64_t target = static_cast<std::uint64_t>(wanted);
+        if (static_cast<double>(target) < wanted || target == 0) ++target;
+
+        std::uint64_t seen = 0;
+        for (std::size_t i = 0; i < kBuckets; ++i) {
+            seen += counts_[i];
+            if (seen >= target) return std::min(highestIn(i), max_);
+        }
+        return max_;
+    }
+
+private:
+    static constexpr unsigned kSubBits = 5;
+    static constexpr std::size_t kSubBuckets = std::size_t{ 1 } << kSubBits;
+    static constexpr std::size_t kLinear = kSubBuckets * 2;
+    static constexpr std::size_t kBuckets = kLinear + (64 - kSubBits - 1) * kSubBuckets;
+
+    std::array<std::uint64_t, kBuckets> counts_{};
+    std::uint64_t count_ = 0;
+    std::uint64_t sum_ = 0;
+    std::uint64_t min_ = UINT64_MAX;
+    std::uint64_t max_ = 0;
+
+    static std::size_t indexOf(std::uint64_t value) {
+        if (value < kLinear) return static_cast<std::size_t>(value);
+        const unsigned shift = static_cast<unsigned>(std::bit_width(value)) - kSubBits - 1;
+        return kLinear + (shift - 1) * kSubBuckets + static_cast<std::size_t>((value >> shift) - kSubBuckets);
+    }
+
+    static std::uint64_t highestIn(std::size_t index) {
+        if (index < kLinear) return index;
+        const unsigned shift = static_cast<unsigned>((index - kLinear) / kSubBuckets) + 1;
+        const std::uint64_t sub = (index - kLinear) % kSubBuckets + kSubBuckets;
+        return ((sub + 1) << shift) - 1;
+    }
+};
+
+// Cheapest monotonic tick source available: the TSC on x86-64, steady_clock elsewhere.
+namespace latency_clock {
+    inline std::uint64_t now() {
+#if defined(__x86_64__) || defined(_M_X64)
+        return __rdtsc();
+#else
+        return static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+    }
+
+    // Measured once against steady_clock on first use (a few milliseconds).
+    inline double nanosPerTick() {
+        static const double ratio = [] {
+            using Clock = std::chrono::steady_clock;
+            const auto wallStart = Clock::now();
+            const std::uint64_t tickStart = now();
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            const std::uint64_t ticks = now() - tickStart;
+            const double nanos = std::chrono::duration<double, std::nano>(Clock::now() - wallStart).count();
+            return ticks ? nanos / static_cast<double>(ticks) : 1.0;
+        }();
+        return ratio;
+    }
+}
+
+// Records the nanoseconds between construction and destruction into a histogram.
+class ScopedLatency {
+public:
+    explicit ScopedLatency(Histogram& histogram) : histogram_(histogram), start_(latency_clock::now()) {}
+    ~ScopedLatency() {
+        const std::uint64_t ticks = latency_clock::now() - start_;
+        histogram_.record(static_cast<std::uint64_t>(static_cast<double>(ticks) * latency_clock::nanosPerTick()));
+    }
+
+    ScopedLatency(const ScopedLatency&) = delete;
+    ScopedLatency& operator=(const ScopedLatency&) = delete;
+
+private:
+    Histogram& histogram_;
+    std::uint64_t start_;
+};
@@ -0,0 +1,262 @@
+#pragma once
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "command.h"
+#include "orderBook.h"
+
+// Append-only binary journal of accepted book commands, for crash recovery by replay.
+//
+// Layout (native endianness): a 32-byte JournalHeader followed by 32-byte JournalRecords.
+// The file is grown in large preallocated steps and written through a shared mapping, so an
+// append is a 32-byte store. The header's record count is refreshed on flush(); a reader also
+// accepts records past it up to the first all-zero slot, so a journal cut short by a crash
+// replays everything that reached the page cache. A record that does not decode (see
+// JournalRecord::isValid) ends the log wherever it sits.
+struct JournalHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t recordSize;
+    std::uint64_t recordCount;
+    std::uint64_t reserved;
+};
+
+struct JournalRecord {
+    std::uint8_t type; // CommandType + 1, so a zero byte marks unwritten space
+    std::uint8_t side;
+    std::uint8_t orderType;
+    std::uint8_t tif;
+    std::int32_t stopOffset; // stop price minus price, for stop orders (zero in older journals)
+    std::uint64_t id;
+    std::int64_t price;
+    std::uint64_t quantity;
+
+    // Stop orders whose stop price lies more than 2^31 ticks from their price have no record.
+    static bool fits(const Command& command) {
+        const Price offset = command.stopPrice - command.price;
+        return offset >= INT32_MIN && offset <= INT32_MAX;
+    }
+
+    static JournalRecord from(const Command& command) {
+        return JournalRecord{
+            static_cast<std::uint8_t>(static_cast<std::uint8_t>(command.type) + 1),
+            static_cast<std::uint8_t>(command.side),
+            static_cast<std::uint8_t>(command.orderType),
+            static_cast<std::uint8_t>(command.tif),
+            isStopCommand(command) ? static_cast<std::int32_t>(command.stopPrice - command.price) : 0,
+            command.id,
+            command.price,
+            command.quantity
+        };
+    }
+
+    // Every byte toCommand turns into an enum is in range, so a torn or corrupt tail ends the log.
+    bool isValid() const {
+        return type >= 1 && type <= 3 && side <= static_cast<std::uint8_t>(Side::SELL)
+            && orderType <= static_cast<std::uint8_t>(OrderType::STOP_LIMIT) && tif <= static_cast<std::uint8_t>(TimeInForce::FOK);
+    }
+
+    Command toCommand() const {
+        Command command{
+            static_cast<CommandType>(type - 1),
+            static_cast<Side>(side),
+            static_cast<OrderType>(orderType),
+            static_cast<TimeInForce>(tif),
+            id,
+            price,
+            quantity
+        };
+        if (isStopCommand(command)) command.stopPrice = price + stopOffset;
+        return command;
+    }
+
+    static bool isStopCommand(const Command& command) {
+        return command.type == CommandType::ADD && (command.orderType == OrderType::STOP || command.orderType == OrderType::STOP_LIMIT);
+    }
+};
+
+static_assert(sizeof(JournalHeader) == 32 && std::is_trivially_copyable_v<JournalHeader>);
+static_assert(sizeof(JournalRecord) == 32 && std::is_trivially_copyable_v<JournalRecord>);
+
+inline constexpr char kJournalMagic[8] = { 'O', 'B', 'J', 'R', 'N', 'L', '\0', '\0' };
+inline constexpr std::uint32_t kJournalVersion = 1;
+
+namespace journal_detail {
+    [[noreturn]] inline void fail(const std::string& what, const std::string& path) {
+        throw std::runtime_error(what + " '" + path + "': " + std::strerror(errno));
+    }
+}
+
+class JournalWriter {
+public:
+    // Truncates any existing file at path.
+    explicit JournalWriter(const std::string& path, std::size_t growBytes = std::size_t{ 64 } << 20)
+        : path_(path)
+        , growBytes_(growBytes < sizeof(JournalRecord) * 1024 ? sizeof(JournalRecord) * 1024 : growBytes)
+    {
+        fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd_ < 0) journal_detail::fail("cannot open journal", path_);
+        grow();
+
+        JournalHeader header{};
+        std::memcpy(header.magic, kJournalMagic, sizeof(header.magic));
+        header.version = kJournalVersion;
+        header.recordSize = sizeof(JournalRecord);
+        std::memcpy(base_, &header, sizeof(header));
+    }
+
+    ~JournalWriter() {
+        try {
+            close();
+        } catch (...) {
+        }
+    }
+
+    JournalWriter(const JournalWriter&) = delete;
+    JournalWriter& operator=(const JournalWriter&) = delete;
+
+    void append(const Command& command) {
+        if (JournalRecord::isStopCommand(command) && !JournalRecord::fits(command)) {
+            throw std::runtime_error("stop price too far from price to journal in '" + path_ + "'");
+        }
+        const std::size_t offset = sizeof(JournalHeader) + count_ * sizeof(JournalRecord);
+        if (offset + sizeof(JournalRecord) > mapped_) grow();
+
+        const JournalRecord record = JournalRecord::from(command);
+        std::memcpy(base_ + offset, &record, sizeof(record));
+        ++count_;
+    }
+
+    // Publishes the record count and schedules dirty pages for writeback.
+    void flush() {
+        if (!base_) return;
+        writeCount();
+        if (::msync(base_, mapped_, MS_ASYNC) != 0) journal_detail::fail("cannot sync journal", path_);
+    }
+
+    // Flushes synchronously and trims the preallocated tail.
+    void close() {
+        if (!base_) return;
+        writeCount();
+        ::msync(base_, mapped_, MS_SYNC);
+        ::munmap(base_, mapped_);
+        base_ = nullptr;
+
+        const off_t used = static_cast<off_t>(sizeof(JournalHeader) + count_ * sizeof(JournalRecord));
+        const bool trimmed = ::ftruncate(fd_, used) == 0;
+        ::close(fd_);
+        fd_ = -1;
+        if (!trimmed) journal_detail::fail("cannot trim journal", path_);
+    }
+
+    std::uint64_t getRecordCount() const { return count_; }
+
+private:
+    std::string path_;
+    std::size_t growBytes_;
+    int fd_ = -1;
+    char* base_ = nullptr;
+    std::size_t mapped_ = 0;
+    std::uint64_t count_ = 0;
+
+    void writeCount() {
+        std::memcpy(base_ + offsetof(JournalHeader, recordCount), &count_, sizeof(count_));
+    }
+
+    void grow() {
+        const std::size_t size = mapped_ + growBytes_;
+        if (::ftruncate(fd_, static_cast<off_t>(size)) != 0) journal_detail::fail("cannot grow journal", path_);
+
+        if (base_) ::munmap(base_, mapped_);
+        void* mapping = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        if (mapping == MAP_FAILED) journal_detail::fail("cannot map journal", path_);
+        base_ = static_cast<char*>(mapping);
+        mapped_ = size;
+    }
+};
+
+// Read-only mapping of a journal; records() is valid for the reader's lifetime.
+class JournalReader {
+public:
+    explicit JournalReader(const std::string& path) : path_(path) {
+        fd_ = ::open(path.c_str(), O_RDONLY);
+        if (fd_ < 0) journal_detail::fail("cannot open journal", path_);
+
+        struct stat info {};
+        if (::fstat(fd_, &info) != 0) journal_detail::fail("cannot stat journal", path_);
+        size_ = static_cast<std::size_t>(info.st_size);
+        if (size_ < sizeof(JournalHeader)) throw std::runtime_error("journal '" + path_ + "' is truncated");
+
+        void* mapping = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+        if (mapping == MAP_FAILED) journal_detail::fail("cannot map journal", path_);
+        base_ = static_cast<const char*>(mapping);
+        ::madvise(mapping, size_, MADV_SEQUENTIAL);
+
+        JournalHeader header;
+        std::memcpy(&header, base_, sizeof(header));
+        if (std::memcmp(header.magic, kJournalMagic, sizeof(header.magic)) != 0
+            || header.version != kJournalVersion || header.recordSize != sizeof(JournalRecord)) {
+            ::munmap(mapping, size_);
+            ::close(fd_);
+            throw std::runtime_error("'" + path_ + "' is not a version " + std::to_string(kJournalVersion) + " journal");
+        }
+
+        const auto* first = reinterpret_cast<const JournalRecord*>(base_ + sizeof(JournalHeader));
+        const std::size_t capacity = (size_ - sizeof(JournalHeader)) / sizeof(JournalRecord);
+        std::size_t count = 0;
+        while (count < capacity && first[count].isValid()) ++count;
+        records_ = std::span<const JournalRecord>(first, count);
+    }
+
+    ~JournalReader() {
+        if (base_) ::munmap(const_cast<char*>(base_), size_);
+        if (fd_ >= 0) ::close(fd_);
+    }
+
+    JournalReader(const JournalReader&) = delete;
+    JournalReader& operator=(const JournalReader&) = delete;
+
+    std::span<const JournalRecord> records() const { return records_; }
+
+private:
+    std::string path_;
+    int fd_ = -1;
+    const char* base_ = nullptr;
+    std::size_t size_ = 0;
+    std::span<const JournalRecord> records_;
+};
+
+// Applies the command and journals it if the book accepted it. A stop the journal cannot
+// record is refused before it reaches the book.
+template <TradeSink Sink>
+OrderResult applyAndJournal(OrderBook& book, JournalWriter& journal, const Command& command, Sink&& sink) {
+    if (JournalRecord::isStopCommand(command) && !JournalRecord::fits(command)) return OrderResult::rejected(RejectReason::UNSUPPORTED);
+    const OrderResult result = applyCommand(book, command, sink);
+    if (result.accepted()) journal.append(command);
+    return result;
+}
+
+// Streams journaled commands back through the book; returns how many were applied.
+template <TradeSink Sink>
+std::uint64_t replayJournal(OrderBook& book, std::span<const JournalRecord> records, Sink&& sink) {
+    std::uint64_t applied = 0;
+    for (const JournalRecord& record : records) {
+        applied += applyCommand(book, record.toCommand(), sink).accepted() ? 1 : 0;
+    }
+    return applied;
+}
+
+inline std::uint64_t replayJournal(OrderBook& book, std::span<const JournalRecord> records) {
+    return replayJournal(book, records, [](const Trade&) {});
+}
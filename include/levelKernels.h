@@ -0,0 +1,92 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define ORDERBOOK_AVX2_KERNELS 1
+#else
+#define ORDERBOOK_AVX2_KERNELS 0
+#endif
+
+// Scans over a packed array of remaining quantities, as SoaPriceLevel keeps per level: the
+// total, and how far into the queue an incoming quantity reaches. Each has a scalar version
+// and, on x86 with GCC or Clang, an AVX2 version that sumQuantities / findFillCut pick at run
+// time when the CPU has it, so the build needs no -mavx2.
+
+// Where a fill of wanted stops: every slot before index is used up and the slot at index gets
+// wanted - before (all of it, if that is its whole quantity). index == count when the slots
+// hold less than wanted in total, and before is then that total.
+struct FillCut {
+    std::size_t index;
+    std::uint64_t before;
+};
+
+inline std::uint64_t sumQuantitiesScalar(const std::uint64_t* quantities, std::size_t count) {
+    std::uint64_t total = 0;
+    for (std::size_t i = 0; i < count; ++i) total += quantities[i];
+    return total;
+}
+
+inline FillCut findFillCutScalar(const std::uint64_t* quantities, std::size_t count, std::uint64_t wanted, std::size_t from = 0,
+    std::uint64_t before = 0) {
+    for (std::size_t i = from; i < count; ++i) {
+        if (before + quantities[i] >= wanted) return FillCut{ i, before };
+        before += quantities[i];
+    }
+    return FillCut{ count, before };
+}
+
+#if ORDERBOOK_AVX2_KERNELS
+__attribute__((target("avx2"))) inline std::uint64_t horizontalSum(__m256i lanes) {
+    const __m128i half = _mm_add_epi64(_mm256_castsi256_si128(lanes), _mm256_extracti128_si256(lanes, 1));
+    return static_cast<std::uint64_t>(_mm_cvtsi128_si64(half)) + static_cast<std::uint64_t>(_mm_extract_epi64(half, 1));
+}
+
+__attribute__((target("avx2"))) inline std::uint64_t sumQuantitiesAvx2(const std::uint64_t* quantities, std::size_t count) {
+    __m256i a = _mm256_setzero_si256();
+    __m256i b = _mm256_setzero_si256();
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        a = _mm256_add_epi64(a, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(quantities + i)));
+        b = _mm256_add_epi64(b, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(quantities + i + 4)));
+    }
+    return horizontalSum(_mm256_add_epi64(a, b)) + sumQuantitiesScalar(quantities + i, count - i);
+}
+
+// Skips whole 8-slot blocks while they cannot reach wanted, then finishes slot by slot.
+__attribute__((target("avx2"))) inline FillCut findFillCutAvx2(const std::uint64_t* quantities, std::size_t count, std::uint64_t wanted) {
+    std::uint64_t before = 0;
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256i pair = _mm256_add_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(quantities + i)),
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(quantities + i + 4)));
+        const std::uint64_t block = horizontalSum(pair);
+        if (before + block >= wanted) break;
+        before += block;
+    }
+    return findFillCutScalar(quantities, count, wanted, i, before);
+}
+
+inline bool cpuHasAvx2() {
+    static const bool available = __builtin_cpu_supports("avx2");
+    return available;
+}
+#else
+inline bool cpuHasAvx2() { return false; }
+#endif
+
+inline std::uint64_t sumQuantities(const std::uint64_t* quantities, std::size_t count) {
+#if ORDERBOOK_AVX2_KERNELS
+    if (cpuHasAvx2()) return sumQuantitiesAvx2(quantities, count);
+#endif
+    return sumQuantitiesScalar(quantities, count);
+}
+
+inline FillCut findFillCut(const std::uint64_t* quantities, std::size_t count, std::uint64_t wanted) {
+#if ORDERBOOK_AVX2_KERNELS
+    // Levels shorter than a block gain nothing from the vector pass.
+    if (count >= 16 && cpuHasAvx2()) return findFillCutAvx2(quantities, count, wanted);
+#endif
+    return findFillCutScalar(quantities, count, wanted);
+}
@@ -0,0 +1,345 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "histogram.h"
+#include "orderBook.h"
+#include "spscRing.h"
+
+// Market data for other processes: one book's order events and level updates as fixed-size
+// records in a POSIX shared-memory ring, with a single writer and any number of readers
+// (POSIX only).
+//
+// Layout: a MarketDataRingHeader, then a power-of-two number of 64-byte slots, one record
+// each. Record n (numbered from 1) lives in slot (n - 1) % capacity. The writer never waits
+// for readers. Each slot carries a version: odd while the writer fills it, 2n once record n is
+// complete. A reader expecting record n compares the version before and after copying, so it
+// can tell "not written yet" from "already overwritten", and an overrun reader knows exactly
+// how many records it missed. Payload words are relaxed atomics (as in Seqlock), so the racing
+// copy is well defined.
+
+enum class MarketDataType : std::uint8_t {
+    NONE,
+    ORDER, // an OrderEvent; action is its OrderEventAction
+    LEVEL, // a LevelUpdate; action is its LevelAction, quantity the level's new volume
+};
+
+struct MarketDataRecord {
+    std::uint64_t sequence;       // from 1, with no gaps
+    std::uint64_t publishedTicks; // latency_clock at publish, shared by a batch
+    MarketDataType type;
+    std::uint8_t action;
+    Side side;
+    std::uint8_t reserved[5];
+    OrderId id;          // ORDER: the resting order
+    OrderId aggressorId; // ORDER FILL: the incoming order
+    Price price;
+    Quantity quantity;
+
+    OrderEventAction orderAction() const { return static_cast<OrderEventAction>(action); }
+    LevelAction levelAction() const { return static_cast<LevelAction>(action); }
+
+    static MarketDataRecord from(const OrderEvent& event) {
+        return MarketDataRecord{ 0, 0, MarketDataType::ORDER, static_cast<std::uint8_t>(event.action), event.side, {},
+            event.id, event.aggressorId, event.price, event.quantity };
+    }
+
+    static MarketDataRecord from(const LevelUpdate& update) {
+        return MarketDataRecord{ 0, 0, MarketDataType::LEVEL, static_cast<std::uint8_t>(update.action), update.side, {},
+            0, 0, update.price, update.volume };
+    }
+};
+
+static_assert(sizeof(MarketDataRecord) == 56 && std::is_trivially_copyable_v<MarketDataRecord>);
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "slots are shared between processes");
+
+struct MarketDataRingHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t recordSize;
+    std::uint64_t capacity;
+    // Records complete so far, raised once per batch; and whether the writer has gone.
+    alignas(kCacheLineSize) std::atomic<std::uint64_t> published;
+    std::atomic<std::uint32_t> closed;
+};
+
+inline constexpr char kMarketDataMagic[8] = { 'O', 'B', 'M', 'D', 'R', 'N', 'G', '\0' };
+inline constexpr std::uint32_t kMarketDataVersion = 1;
+
+namespace market_data_detail {
+    inline constexpr std::size_t kWords = sizeof(MarketDataRecord) / sizeof(std::uint64_t);
+
+    struct alignas(kCacheLineSize) Slot {
+        std::atomic<std::uint64_t> version;
+        std::array<std::atomic<std::uint64_t>, kWords> words;
+    };
+
+    static_assert(sizeof(Slot) == kCacheLineSize);
+
+    inline std::size_t slotsOffset() {
+        return (sizeof(MarketDataRingHeader) + kCacheLineSize - 1) / kCacheLineSize * kCacheLineSize;
+    }
+
+    inline std::size_t mappedSize(std::uint64_t capacity) {
+        return slotsOffset() + static_cast<std::size_t>(capacity) * sizeof(Slot);
+    }
+
+    [[noreturn]] inline void fail(const std::string& what, const std::string& name) {
+        throw std::runtime_error(what + " '" + name + "': " + std::strerror(errno));
+    }
+}
+
+// Writer side; one thread, normally the matcher. Creates (or replaces) the shared-memory
+// object under name and removes the name again on destruction, so a reader that opens it
+// afterwards fails while readers already attached keep their mapping.
+class MarketDataPublisher {
+public:
+    // name is a POSIX shared-memory name ("/feed"); capacity is rounded up to a power of two.
+    // Without timestamps publishedTicks stays 0, which saves a clock read per command (a few
+    // ns on bare metal, tens under some hypervisors).
+    explicit MarketDataPublisher(const std::string& name, std::size_t capacity = std::size_t{ 1 } << 20, bool timestamps = true)
+        : name_(name)
+        , capacity_(std::bit_ceil(std::max<std::size_t>(capacity, 1024)))
+        , mask_(capacity_ - 1)
+        , size_(market_data_detail::mappedSize(capacity_))
+        , timestamps_(timestamps)
+    {
+        const int fd = ::shm_open(name_.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) market_data_detail::fail("cannot create market data ring", name_);
+        if (::ftruncate(fd, static_cast<off_t>(size_)) != 0) {
+            ::close(fd);
+            ::shm_unlink(name_.c_str());
+            market_data_detail::fail("cannot size market data ring", name_);
+        }
+        // Fault every page in now rather than on the matcher's first lap.
+        int flags = MAP_SHARED;
+#ifdef MAP_POPULATE
+        flags |= MAP_POPULATE;
+#endif
+        void* base = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, flags, fd, 0);
+        ::close(fd);
+        if (base == MAP_FAILED) {
+            ::shm_unlink(name_.c_str());
+            market_data_detail::fail("cannot map market data ring", name_);
+        }
+
+        // Fresh pages are zero: every slot reads as never written.
+        base_ = static_cast<std::byte*>(base);
+        header_ = new (base_) MarketDataRingHeader{};
+        slots_ = reinterpret_cast<market_data_detail::Slot*>(base_ + market_data_detail::slotsOffset());
+        std::memcpy(header_->magic, kMarketDataMagic, sizeof(header_->magic));
+        header_->version = kMarketDataVersion;
+        header_->recordSize = sizeof(MarketDataRecord);
+        header_->capacity = capacity_;
+        header_->published.store(0, std::memory_order_release);
+    }
+
+    ~MarketDataPublisher() {
+        close();
+    }
+
+    MarketDataPublisher(const MarketDataPublisher&) = delete;
+    MarketDataPublisher& operator=(const MarketDataPublisher&) = delete;
+
+    // Routes the book's order events and level updates here, replacing any handlers it had.
+    // The ring only carries changes, so attach before the book holds orders. A command's level
+    // updates always follow its order events, so they share its timestamp. The handlers point
+    // at this publisher: detach the book before the publisher is destroyed, unless the book
+    // goes first. Once closed, the publisher drops whatever still reaches it.
+    template <typename Policy>
+    void attach(BasicOrderBook<Policy>& book) {
+        book.setOrderEventHandler([this](std::span<const OrderEvent> events) {
+            commandTicks_ = stamp();
+            publishBatch(events, commandTicks_);
+        });
+        book.setLevelUpdateHandler([this](std::span<const LevelUpdate> updates) { publishBatch(updates, commandTicks_); });
+    }
+
+    // Removes the handlers attach installed.
+    template <typename Policy>
+    void detach(BasicOrderBook<Policy>& book) {
+        book.setOrderEventHandler(nullptr);
+        book.setLevelUpdateHandler(nullptr);
+    }
+
+    void publish(std::span<const OrderEvent> events) { publishBatch(events, stamp()); }
+    void publish(std::span<const LevelUpdate> updates) { publishBatch(updates, stamp()); }
+
+    void publish(const MarketDataRecord& record) {
+        if (!base_) return;
+        write(record, stamp());
+        header_->published.store(next_ - 1, std::memory_order_release);
+    }
+
+    // Tells readers no more records are coming, then unmaps and removes the name.
+    void close() {
+        if (!base_) return;
+        header_->closed.store(1, std::memory_order_release);
+        ::munmap(base_, size_);
+        ::shm_unlink(name_.c_str());
+        base_ = nullptr;
+        header_ = nullptr;
+        slots_ = nullptr;
+    }
+
+    std::uint64_t getPublished() const { return next_ - 1; }
+    std::size_t getCapacity() const { return capacity_; }
+    const std::string& getName() const { return name_; }
+
+private:
+    std::string name_;
+    std::size_t capacity_;
+    std::size_t mask_;
+    std::size_t size_;
+    bool timestamps_;
+    std::byte* base_ = nullptr;
+    MarketDataRingHeader* header_ = nullptr;
+    market_data_detail::Slot* slots_ = nullptr;
+    std::uint64_t next_ = 1;
+    std::uint64_t commandTicks_ = 0;
+
+    std::uint64_t stamp() const { return timestamps_ ? latency_clock::now() : 0; }
+
+    template <typename Event>
+    void publishBatch(std::span<const Event> events, std::uint64_t ticks) {
+        if (!base_) return;
+        for (const Event& event : events) write(MarketDataRecord::from(event), ticks);
+        header_->published.store(next_ - 1, std::memory_order_release);
+    }
+
+    // The sequence and timestamp go straight into the slot's first two words; the rest of the
+    // record is copied a word at a time. Callers have checked the ring is still mapped.
+    void write(const MarketDataRecord& record, std::uint64_t ticks) {
+        const std::uint64_t sequence = next_++;
+        market_data_detail::Slot& slot = slots_[(sequence - 1) & mask_];
+        slot.version.store(2 * sequence - 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.words[0].store(sequence, std::memory_order_relaxed);
+        slot.words[1].store(ticks, std::memory_order_relaxed);
+        const auto* bytes = reinterpret_cast<const std::byte*>(&record);
+        for (std::size_t i = 2; i < market_data_detail::kWords; ++i) {
+            std::uint64_t word;
+            std::memcpy(&word, bytes + i * sizeof(word), sizeof(word));
+            slot.words[i].store(word, std::memory_order_relaxed);
+        }
+        slot.version.store(2 * sequence, std::memory_order_release);
+    }
+};
+
+enum class MarketDataRead { RECORD, EMPTY, OVERRUN };
+
+// Reader side, in any process; each reader has its own position and never affects the writer.
+class MarketDataReader {
+public:
+    enum class Start { LATEST, OLDEST };
+
+    // LATEST starts after the last record already published; OLDEST at the oldest still in the ring.
+    explicit MarketDataReader(const std::string& name, Start start = Start::LATEST) : name_(name) {
+        const int fd = ::shm_open(name_.c_str(), O_RDONLY, 0);
+        if (fd < 0) market_data_detail::fail("cannot open market data ring", name_);
+        struct stat info {};
+        if (::fstat(fd, &info) != 0) {
+            ::close(fd);
+            market_data_detail::fail("cannot stat market data ring", name_);
+        }
+        size_ = static_cast<std::size_t>(info.st_size);
+        if (size_ < market_data_detail::slotsOffset()) {
+            ::close(fd);
+            throw std::runtime_error("market data ring '" + name_ + "' is truncated");
+        }
+        void* base = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (base == MAP_FAILED) market_data_detail::fail("cannot map market data ring", name_);
+
+        base_ = static_cast<std::byte*>(base);
+        header_ = reinterpret_cast<const MarketDataRingHeader*>(base_);
+        const std::uint64_t capacity = header_->capacity;
+        if (std::memcmp(header_->magic, kMarketDataMagic, sizeof(kMarketDataMagic)) != 0
+            || header_->version != kMarketDataVersion || header_->recordSize != sizeof(MarketDataRecord)
+            || !std::has_single_bit(capacity) || market_data_detail::mappedSize(capacity) > size_) {
+            ::munmap(base_, size_);
+            throw std::runtime_error("'" + name_ + "' is not a market data ring this build can read");
+        }
+        capacity_ = static_cast<std::size_t>(capacity);
+        mask_ = capacity_ - 1;
+        slots_ = reinterpret_cast<const market_data_detail::Slot*>(base_ + market_data_detail::slotsOffset());
+
+        const std::uint64_t published = header_->published.load(std::memory_order_acquire);
+        next_ = start == Start::LATEST ? published + 1 : (published >= capacity_ ? published - capacity_ + 2 : 1);
+    }
+
+    ~MarketDataReader() {
+        if (base_) ::munmap(base_, size_);
+    }
+
+    MarketDataReader(const MarketDataReader&) = delete;
+    MarketDataReader& operator=(const MarketDataReader&) = delete;
+
+    // One attempt at the next record. OVERRUN means the writer lapped this reader: it has moved
+    // on to a record the writer is not about to reuse, and getLost() counts what it skipped.
+    // Anything built from the earlier records is then stale.
+    MarketDataRead poll(MarketDataRecord& out) {
+        const market_data_detail::Slot& slot = slots_[(next_ - 1) & mask_];
+        std::uint64_t version = slot.version.load(std::memory_order_acquire);
+        if (version < 2 * next_) return MarketDataRead::EMPTY;
+        if (version == 2 * next_) {
+            std::array<std::uint64_t, market_data_detail::kWords> words;
+            for (std::size_t i = 0; i < words.size(); ++i) words[i] = slot.words[i].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            const std::uint64_t after = slot.version.load(std::memory_order_relaxed);
+            if (after == version) {
+                std::memcpy(&out, words.data(), sizeof(out));
+                ++next_;
+                return MarketDataRead::RECORD;
+            }
+            version = after;
+        }
+        skipAhead((version + 1) / 2);
+        return MarketDataRead::OVERRUN;
+    }
+
+    // True once the writer has closed and every record it published has been read.
+    bool isFinished() const {
+        return header_->closed.load(std::memory_order_acquire) && next_ > header_->published.load(std::memory_order_acquire);
+    }
+
+    std::uint64_t getNextSequence() const { return next_; }
+    std::uint64_t getLost() const { return lost_; }
+    std::size_t getCapacity() const { return capacity_; }
+
+private:
+    std::string name_;
+    std::size_t size_ = 0;
+    std::byte* base_ = nullptr;
+    const MarketDataRingHeader* header_ = nullptr;
+    const market_data_detail::Slot* slots_ = nullptr;
+    std::size_t capacity_ = 0;
+    std::size_t mask_ = 0;
+    std::uint64_t next_ = 1;
+    std::uint64_t lost_ = 0;
+
+    // Half a ring behind the writer, so it is not overrun again straight away. The slot that
+    // showed the overrun may be ahead of the published count, which only moves per batch.
+    void skipAhead(std::uint64_t seen) {
+        const std::uint64_t writer = std::max(header_->published.load(std::memory_order_acquire), seen);
+        const std::uint64_t resume = writer - capacity_ / 2 + 1;
+        lost_ += resume - next_;
+        next_ = resume;
+    }
+};
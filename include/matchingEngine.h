@@ -0,0 +1,216 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "command.h"
+#include "orderBook.h"
+#include "spscRing.h"
+
+using SymbolId = std::uint32_t;
+
+struct MatchingEngineConfig {
+    std::size_t shardCount = 1;
+    // Commands in flight per shard before submit() has to wait.
+    std::size_t ringCapacity = std::size_t{ 1 } << 16;
+    // Pin shard i to core (firstCore + i) % hardware threads.
+    bool pinThreads = true;
+    unsigned firstCore = 0;
+    OrderBookConfig bookConfig{};
+};
+
+// Many single-instrument OrderBooks spread over worker shards, one thread per shard.
+// Symbols are dealt round-robin to shards; each shard owns its books outright and applies
+// their commands strictly in arrival order, so a book is only ever touched by one thread.
+// A single ingress thread hands commands over through a lock-free SPSC ring per shard.
+class MatchingEngine {
+public:
+    using TradeHandler = std::function<void(SymbolId, const Trade&)>;
+
+    struct ShardStats {
+        std::uint64_t commands = 0;
+        std::uint64_t rejects = 0;
+        std::uint64_t trades = 0;
+    };
+
+    // tradeHandler, if set, runs on the shard thread for every fill.
+    explicit MatchingEngine(const MatchingEngineConfig& config, TradeHandler tradeHandler = {})
+        : config_(config)
+        , tradeHandler_(std::move(tradeHandler))
+    {
+        if (config_.shardCount == 0) throw std::invalid_argument("matching engine needs at least one shard");
+        for (std::size_t i = 0; i < config_.shardCount; ++i) {
+            shards_.push_back(std::make_unique<Shard>(config_.ringCapacity));
+        }
+    }
+
+    ~MatchingEngine() { stop(); }
+
+    MatchingEngine(const MatchingEngine&) = delete;
+    MatchingEngine& operator=(const MatchingEngine&) = delete;
+
+    // Symbols must all be registered before start().
+    SymbolId addSymbol(const std::string& name) {
+        if (running_) throw std::logic_error("symbols must be added before the engine starts");
+
+        const SymbolId symbol = static_cast<SymbolId>(symbols_.size());
+        const std::uint32_t shardIndex = static_cast<std::uint32_t>(symbol % shards_.size());
+        Shard& shard = *shards_[shardIndex];
+
+        shard.books.push_back(std::make_unique<OrderBook>(config_.bookConfig));
+        shard.symbols.push_back(symbol);
+        symbols_.push_back(SymbolSlot{ shardIndex, static_cast<std::uint32_t>(shard.books.size() - 1), name });
+        return symbol;
+    }
+
+    void start() {
+        if (running_) return;
+        running_ = true;
+        for (std::size_t i = 0; i < shards_.size(); ++i) {
+            shards_[i]->thread = std::thread([this, i] { runShard(i); });
+        }
+    }
+
+    // Ingress thread only. Spins (yielding) while the shard's ring is full.
+    void submit(SymbolId symbol, const Command& command) {
+        const SymbolSlot& slot = symbols_[symbol];
+        Shard& shard = *shards_[slot.shard];
+        const Envelope envelope{ slot.book, command };
+        while (!shard.ring.tryPush(envelope)) {
+            std::this_thread::yield();
+        }
+        ++shard.submitted;
+    }
+
+    // Ingress thread only. Returns once every submitted command has been applied; books and
+    // stats may then be read from the ingress thread until the next submit().
+    void waitIdle() const {
+        for (const auto& shard : shards_) {
+            while (shard->processed.load(std::memory_order_acquire) != shard->submitted) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    // Drains every ring and joins the shard threads.
+    void stop() {
+        if (!running_) return;
+        running_ = false;
+        for (auto& shard : shards_) {
+            if (shard->thread.joinable()) shard->thread.join();
+        }
+    }
+
+    std::size_t getShardCount() const { return shards_.size(); }
+    std::size_t getSymbolCount() const { return symbols_.size(); }
+    std::size_t getShardOf(SymbolId symbol) const { return symbols_[symbol].shard; }
+    const std::string& getSymbolName(SymbolId symbol) const { return symbols_[symbol].name; }
+
+    // Only while idle (see waitIdle) or stopped.
+    const OrderBook& getBook(SymbolId symbol) const {
+        const SymbolSlot& slot = symbols_[symbol];
+        return *shards_[slot.shard]->books[slot.book];
+    }
+
+    ShardStats getShardStats(std::size_t shard) const { return shards_[shard]->stats; }
+
+    ShardStats getTotalStats() const {
+        ShardStats total;
+        for (const auto& shard : shards_) {
+            total.commands += shard->stats.commands;
+            total.rejects += shard->stats.rejects;
+            total.trades += shard->stats.trades;
+        }
+        return total;
+    }
+
+private:
+    static constexpr std::size_t kDrainBatch = 256;
+
+    struct Envelope {
+        std::uint32_t book;
+        Command command;
+    };
+
+    struct SymbolSlot {
+        std::uint32_t shard;
+        std::uint32_t book;
+        std::string name;
+    };
+
+    struct Shard {
+        explicit Shard(std::size_t ringCapacity) : ring(ringCapacity) {}
+
+        SpscRing<Envelope> ring;
+        std::vector<std::unique_ptr<OrderBook>> books;
+        std::vector<SymbolId> symbols;
+        std::thread thread;
+        // Shard-thread side.
+        alignas(kCacheLineSize) ShardStats stats;
+        std::atomic<std::uint64_t> processed{ 0 };
+        // Ingress-thread side.
+        alignas(kCacheLineSize) std::uint64_t submitted = 0;
+    };
+
+    MatchingEngineConfig config_;
+    TradeHandler tradeHandler_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::vector<SymbolSlot> symbols_;
+    std::atomic<bool> running_{ false };
+
+    static void pinCurrentThread(unsigned core) {
+#ifdef __linux__
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(core, &cpus);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+#else
+        (void)core;
+#endif
+    }
+
+    void runShard(std::size_t index) {
+        Shard& shard = *shards_[index];
+        if (config_.pinThreads) {
+            const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+            pinCurrentThread(static_cast<unsigned>((config_.firstCore + index) % cores));
+        }
+
+        std::uint64_t processed = 0;
+        for (;;) {
+            const std::size_t drained = shard.ring.consumeBatch(kDrainBatch, [&](const Envelope& envelope) {
+                const SymbolId symbol = shard.symbols[envelope.book];
+                auto onTrade = [&](const Trade& trade) {
+                    ++shard.stats.trades;
+                    if (tradeHandler_) tradeHandler_(symbol, trade);
+                };
+
+                ++shard.stats.commands;
+                if (!applyCommand(*shard.books[envelope.book], envelope.command, onTrade).accepted()) {
+                    ++shard.stats.rejects;
+                }
+            });
+
+            if (drained > 0) {
+                processed += drained;
+                shard.processed.store(processed, std::memory_order_release);
+                continue;
+            }
+
+            if (!running_.load(std::memory_order_acquire) && shard.ring.empty()) break;
+            std::this_thread::yield();
+        }
+    }
+};
@@ -1,49 +1,64 @@
 ﻿#pragma once
-#include <map>
-#include <unordered_map>
-#include <list>
+#include <algorithm>
+#include <array>
+#include <concepts>
+#include <cstdint>
+#include <functional>
+#include <span>
 #include <vector>
-#include <stdexcept>
-#include <format>
 #include <optional>
+#include <type_traits>
+
+#include "histogram.h"
+#include "orderIdIndex.h"
+#include "orderPool.h"
+#include "priceLadder.h"
 
 // Type aliases
 using Price = int64_t;
 using Quantity = uint64_t;
 using OrderId = uint64_t;
 
-// Enums
-enum class Side { BUY, SELL };
-enum class OrderType { LIMIT, MARKET };
-enum class TimeInForce { GTC, IOC, FOK };  // Good-Till-Cancel, Immediate-or-Cancel, Fill-or-Kill
+// Enums (one byte each, so they pack together at the end of an Order)
+enum class Side : std::uint8_t { BUY, SELL };
+// STOP and STOP_LIMIT wait off the book until a trade prints at or through stopPrice (at or
+// above it for buys, at or below for sells), then enter as a MARKET or LIMIT order.
+enum class OrderType : std::uint8_t { LIMIT, MARKET, STOP, STOP_LIMIT };
+enum class TimeInForce : std::uint8_t { GTC, IOC, FOK };  // Good-Till-Cancel, Immediate-or-Cancel, Fill-or-Kill
 
 // Structs
 struct Order {
-    Order(OrderId id, Side side, OrderType type, Price price, Quantity qty, TimeInForce tif)
+    Order(OrderId id, Side side, OrderType type, Price price, Quantity qty, TimeInForce tif, Price stopPrice = 0)
         : id(id)
-        , side(side)
-        , type(type)
+        , remainingQuantity(qty)
         , price(price)
         , quantity(qty)
-        , filledQuantity(0)
+        , stopPrice(stopPrice)
+        , side(side)
+        , type(type)
         , tif(tif)
     {
     }
 
-    void fill(Quantity amount) { filledQuantity += amount; }
-    bool isFilled() const { return filledQuantity == quantity; }
-    Quantity getRemainingQuantity() const { return quantity - filledQuantity; }
+    void fill(Quantity amount) { remainingQuantity -= amount; }
+    bool isFilled() const { return remainingQuantity == 0; }
+    Quantity getRemainingQuantity() const { return remainingQuantity; }
+    Quantity getFilledQuantity() const { return quantity - remainingQuantity; }
 
+    // Read or written on every fill: the first 16 bytes.
     OrderId id;
-    Side side;
-    OrderType type;
+    Quantity remainingQuantity;
     Price price;
+    // Only needed when the order is added, amended or saved.
     Quantity quantity;
-    Quantity filledQuantity;
+    Price stopPrice; // trigger for STOP and STOP_LIMIT, unused otherwise
+    Side side;
+    OrderType type;
     TimeInForce tif;
-
 };
 
+static_assert(sizeof(Order) == 48);
+
 struct Trade {
     OrderId buyOrderId;
     OrderId sellOrderId;
@@ -51,38 +66,176 @@ struct Trade {
     Quantity quantity;
 };
 
-using Orders = std::list<Order>;
+// Level-by-level (L2) change feed: the new total volume at a price after one inbound command.
+enum class LevelAction { ADD, CHANGE, REMOVE };
+
+struct LevelUpdate {
+    Price price;
+    Quantity volume;
+    Side side;
+    LevelAction action;
+};
+
+using LevelUpdateHandler = std::function<void(std::span<const LevelUpdate>)>;
+
+// Market-by-order view of one command: what happened to individual resting orders. Pending
+// stops are not visible until they trigger and rest.
+enum class OrderEventAction : std::uint8_t {
+    ADD,    // order queued at the back of its level with quantity (a repriced modify is REMOVE then ADD)
+    REDUCE, // in-place amend down to quantity, keeping queue priority
+    REMOVE, // cancelled with quantity still open
+    FILL,   // quantity traded against the resting order at price; it is gone once nothing remains
+    CLEAR,  // cancelAll: every resting order is gone
+};
+
+struct OrderEvent {
+    OrderId id;          // the resting order
+    OrderId aggressorId; // FILL only
+    Price price;
+    Quantity quantity;
+    Side side;           // of the resting order
+    OrderEventAction action;
+};
+
+using OrderEventHandler = std::function<void(std::span<const OrderEvent>)>;
+
+// Anything that can take fills one at a time: a lambda, a ring buffer, a reusable vector.
+template <typename Sink>
+concept TradeSink = std::invocable<Sink&, const Trade&>;
+
+// Takes the id of each order a mass cancel removes.
+template <typename Sink>
+concept CancelSink = std::invocable<Sink&, OrderId>;
+
+// Resting orders live in a slab with intrusive links; a level is a FIFO threaded through it.
+using OrderPool = IntrusivePool<Order>;
 
 struct OrderEntry {
     //Order order_;
-    Orders::iterator location_;
+    OrderHandle location_ = kInvalidHandle;
 };
 
+// A level's order queue. The book only goes through addOrder, removeOrder, reduceOrder, match,
+// forEachOrder, getTotalVolume and isEmpty, so a policy can swap in another queue with the same
+// members (SoaPriceLevel in soaPriceLevel.h).
 struct PriceLevel {
     PriceLevel() : totalVolume_(0) {}
 
-    void addOrder(const Order& order) {
-        orders_.push_back(order);
-        totalVolume_ += order.getRemainingQuantity();
+    template <typename Pool>
+    void addOrder(Pool& pool, OrderHandle handle) {
+        pool.prev(handle) = tail_;
+        pool.next(handle) = kInvalidHandle;
+        if (tail_ == kInvalidHandle) head_ = handle;
+        else pool.next(tail_) = handle;
+        tail_ = handle;
+        totalVolume_ += pool[handle].getRemainingQuantity();
     }
 
-    void removeOrder(const Orders::iterator& location) {
-        totalVolume_ -= location->getRemainingQuantity();
-        orders_.erase(location);
+    template <typename Pool>
+    void removeOrder(Pool& pool, OrderHandle handle) {
+        totalVolume_ -= pool[handle].getRemainingQuantity();
+        const OrderHandle prev = pool.prev(handle);
+        const OrderHandle next = pool.next(handle);
+        if (prev == kInvalidHandle) head_ = next;
+        else pool.next(prev) = next;
+        if (next == kInvalidHandle) tail_ = prev;
+        else pool.prev(next) = prev;
     }
 
-    void removeFrontOrder() {
-        totalVolume_ -= orders_.front().getRemainingQuantity();
-        orders_.pop_front();
+    template <typename Pool>
+    void removeFrontOrder(Pool& pool) { removeOrder(pool, head_); }
+
+    // The order at handle gives up released of its remaining quantity in place; the caller
+    // updates the order itself.
+    template <typename Pool>
+    void reduceOrder(Pool&, OrderHandle, Quantity released) { totalVolume_ -= released; }
+
+    // Fills up to wanted from the front of the queue, oldest first. Each order filled into is
+    // updated, taken out of the queue if that filled it, and then passed to
+    // onFill(handle, order, quantity), which may release its slot. Returns the quantity filled.
+    template <typename Pool, typename OnFill>
+    Quantity match(Pool& pool, Quantity wanted, OnFill&& onFill) {
+        Quantity filled = 0;
+        while (head_ != kInvalidHandle && filled < wanted) {
+            const OrderHandle handle = head_;
+            auto& order = pool[handle];
+            const Quantity quantity = std::min(wanted - filled, order.getRemainingQuantity());
+            order.fill(quantity);
+            filled += quantity;
+            if (order.isFilled()) {
+                head_ = pool.next(handle);
+                if (head_ == kInvalidHandle) tail_ = kInvalidHandle;
+                else pool.prev(head_) = kInvalidHandle;
+            }
+            onFill(handle, order, quantity);
+        }
+        totalVolume_ -= filled;
+        return filled;
+    }
+
+    // Visits the queue in time priority. fn(handle) may release the slot it is given (the
+    // level is then left to be reset) but must not otherwise change the level.
+    template <typename Pool, typename Fn>
+    void forEachOrder(const Pool& pool, Fn&& fn) const {
+        for (OrderHandle handle = head_; handle != kInvalidHandle;) {
+            const OrderHandle next = pool.next(handle);
+            fn(handle);
+            handle = next;
+        }
+    }
+
+    // Re-adds the queue's remaining quantities, e.g. to check the running total.
+    template <typename Pool>
+    Quantity recomputeTotalVolume(const Pool& pool) {
+        totalVolume_ = 0;
+        forEachOrder(pool, [&](OrderHandle handle) { totalVolume_ += pool[handle].getRemainingQuantity(); });
+        return totalVolume_;
     }
 
     Quantity getTotalVolume() const { return totalVolume_; }
 
-    bool isEmpty() const { return orders_.empty(); }
+    bool isEmpty() const { return head_ == kInvalidHandle; }
+
+    OrderHandle front() const { return head_; }
 
     //Price price_;
     Quantity totalVolume_;
-    Orders orders_;
+    OrderHandle head_ = kInvalidHandle;
+    OrderHandle tail_ = kInvalidHandle;
+};
+
+struct OrderBookConfig {
+    // Dense tick band for each side; 0 keeps every level in the tree.
+    Price ladderBase = 0;
+    std::size_t ladderTicks = 0;
+    // Resting orders to preallocate pool slots and index space for.
+    std::size_t orderCapacity = 0;
+    // Order-id lookup; the dense window only pays off when ids are roughly monotonic.
+    IdIndexKind idIndex = IdIndexKind::FLAT_HASH;
+    std::size_t idWindow = std::size_t{ 1 } << 20;
+};
+
+// Build with ORDERBOOK_STATS=1 to have every default-policy book time its operations and size
+// its sweeps. Off by default: the hooks then compile away and getStats() stays empty.
+#ifndef ORDERBOOK_STATS
+#define ORDERBOOK_STATS 0
+#endif
+
+struct OrderBookStats {
+    // Nanoseconds per call, fills included.
+    Histogram addNanos;
+    Histogram cancelNanos;
+    Histogram modifyNanos;
+    // Only matches that traded: time in the matching loop, levels it swept, resting orders it filled into.
+    Histogram matchNanos;
+    Histogram levelsSwept;
+    Histogram ordersTouched;
+};
+
+// Trade analytics stage a policy leaves out. A replacement (TradeAnalytics in tradeAnalytics.h)
+// is told about every level a match fills into: its price, the quantity and the number of fills.
+struct NoTradeAnalytics {
+    void recordTrades(Price, Quantity, std::uint64_t) {}
 };
 
 struct OrderModify {
@@ -95,85 +248,307 @@ struct OrderModify {
     }
 };
 
-class OrderBook {
+// Why a command was turned away. Every rejection leaves the book exactly as it was.
+enum class RejectReason : std::uint8_t {
+    NONE,
+    UNKNOWN_ID,     // cancel or modify of an id that is not resting or pending (never added, cancelled or filled)
+    DUPLICATE_ID,   // add that would rest or wait under an id that is already resting or pending
+    ZERO_QUANTITY,  // add for nothing
+    FOK_UNFILLABLE, // fill-or-kill that the opposite side cannot fill in full
+    UNSUPPORTED,    // order type or time in force the book's policy leaves out, or a modify of a pending stop
+};
+
+inline const char* rejectReasonName(RejectReason reason) {
+    switch (reason) {
+    case RejectReason::NONE: return "none";
+    case RejectReason::UNKNOWN_ID: return "unknown id";
+    case RejectReason::DUPLICATE_ID: return "duplicate id";
+    case RejectReason::ZERO_QUANTITY: return "zero quantity";
+    case RejectReason::FOK_UNFILLABLE: return "fok unfillable";
+    case RejectReason::UNSUPPORTED: return "unsupported";
+    }
+    return "?";
+}
+
+// Outcome of one mutating call: what the command filled and whether it left an order resting
+// (for a stop that has not triggered yet, waiting in the trigger book).
+struct OrderResult {
+    Quantity filledQuantity = 0;
+    RejectReason reject = RejectReason::NONE;
+    bool resting = false;
+
+    bool accepted() const { return reject == RejectReason::NONE; }
+
+    static OrderResult rejected(RejectReason reason) { return OrderResult{ 0, reason, false }; }
+};
+
+struct BookLevel {
+    Price price;
+    Quantity volume;
+    BookLevel(Price p, Quantity v) : price(p), volume(v) {}
+};
+
+// Compile-time shape of a BasicOrderBook. Policies that change only a few pieces derive from
+// this one and override them.
+struct DefaultBookPolicy {
+    // One side's price levels: PriceLadder (dense band plus tree) or MapLadder (tree only).
+    template <typename Level, bool Descending>
+    using Levels = PriceLadder<Price, Level, Descending>;
+
+    // Resting order storage with intrusive queue links; see IntrusivePool for the interface.
+    template <typename T>
+    using Storage = IntrusivePool<T>;
+
+    // Order queue at each price: PriceLevel, a FIFO linked through the storage, or SoaPriceLevel
+    // (soaPriceLevel.h), which keeps the level's remaining quantities in one array for vector scans.
+    using LevelQueue = PriceLevel;
+
+    // Id lookup: OrderIdIndex chooses hash or dense window from the config at run time,
+    // FlatHashIndex and DenseIdIndex fix the choice.
+    template <typename Value>
+    using IdIndex = OrderIdIndex<Value>;
+
+    // Order kinds addOrder accepts beyond GTC limits. Anything else is rejected up front, and
+    // the matching paths for it are never compiled.
+    static constexpr bool kMarketOrders = true;
+    static constexpr bool kImmediateOrCancel = true;
+    static constexpr bool kFillOrKill = true;
+    static constexpr bool kStopOrders = true;
+
+    static constexpr bool kStats = ORDERBOOK_STATS != 0;
+
+    // Fed from the match loop; see NoTradeAnalytics.
+    using Analytics = NoTradeAnalytics;
+};
+
+// Price-time priority book. Policy fixes its containers and feature set at compile time (see
+// DefaultBookPolicy); the trade sink is already a template argument of every call that fills.
+template <typename Policy = DefaultBookPolicy>
+class BasicOrderBook {
 public:
-    OrderBook()
+    using Level = typename Policy::LevelQueue;
+    using BidLadder = typename Policy::template Levels<Level, true>;
+    using AskLadder = typename Policy::template Levels<Level, false>;
+    using OrderStorage = typename Policy::template Storage<Order>;
+    using IdIndex = typename Policy::template IdIndex<OrderEntry>;
+    // Pending stops by trigger price, each side in the order a moving price reaches them, always
+    // queued through PriceLevel links.
+    using BuyStopLadder = typename Policy::template Levels<PriceLevel, false>;
+    using SellStopLadder = typename Policy::template Levels<PriceLevel, true>;
+    using BookLevel = ::BookLevel;
+
+    using Analytics = typename Policy::Analytics;
+
+    static constexpr bool kStatsEnabled = Policy::kStats;
+    static constexpr bool kAnalyticsEnabled = !std::is_same_v<Analytics, NoTradeAnalytics>;
+
+    explicit BasicOrderBook(const OrderBookConfig& config = {})
+        : bids_(config.ladderBase, config.ladderTicks)
+        , asks_(config.ladderBase, config.ladderTicks)
+        , orders_(config.orderCapacity)
+        , orderLookup_(makeIdIndex(config))
+        , buyStops_(config.ladderBase, Policy::kStopOrders ? config.ladderTicks : 0)
+        , sellStops_(config.ladderBase, Policy::kStopOrders ? config.ladderTicks : 0)
     {
+        orderLookup_.reserve(config.orderCapacity);
     }
 
-    ~OrderBook() = default;
+    ~BasicOrderBook() = default;
+
+    BasicOrderBook(const BasicOrderBook&) = delete;
+    BasicOrderBook& operator=(const BasicOrderBook&) = delete;
 
-    OrderBook(const OrderBook&) = delete;
-    OrderBook& operator=(const OrderBook&) = delete;
+    // The mutating calls never throw: a refused command comes back as a rejected OrderResult.
+    // They are noexcept, so a trade sink or level update handler that throws (or running out
+    // of memory for new pool chunks) terminates instead of leaving a half-applied command.
+
+    // Collects the fills into trades as well; convenient, but allocates.
+    OrderResult addOrder(Order& order, std::vector<Trade>& trades) noexcept {
+        return addOrder(order, [&trades](const Trade& trade) { trades.push_back(trade); });
+    }
 
-    std::vector<Trade> addOrder(Order& order) {
-        std::vector<Trade> trades;
+    // Streams each fill into sink as it happens; nothing is allocated for the report.
+    template <TradeSink Sink>
+    OrderResult addOrder(Order& order, Sink&& sink) noexcept {
+        [[maybe_unused]] auto timer = startTimer<&OrderBookStats::addNanos>();
+        if (!supports(order)) return OrderResult::rejected(RejectReason::UNSUPPORTED);
+        if (order.getRemainingQuantity() == 0) return OrderResult::rejected(RejectReason::ZERO_QUANTITY);
+        if (isStop(order)) return addStop(order, sink);
 
-        if (order.type == OrderType::LIMIT) {
-            if (order.tif == TimeInForce::FOK && !canFullyMatch(order)) {
-                return trades;
+        const Quantity remainingBefore = order.getRemainingQuantity();
+        bool resting = false;
+        if (isLimit(order)) {
+            if (isGoodTillCancel(order) && orderLookup_.find(order.id)) {
+                return OrderResult::rejected(RejectReason::DUPLICATE_ID);
+            }
+            if (isFillOrKill(order) && !canFullyMatch(order)) {
+                return OrderResult::rejected(RejectReason::FOK_UNFILLABLE);
             }
 
-            trades = matchLimitOrder(order);
+            matchLimitOrder(order, sink);
 
-            if (!order.isFilled() && order.tif == TimeInForce::GTC) {
-                PriceLevel& level = (order.side == Side::BUY) ? bids_[order.price] : asks_[order.price];
-                level.addOrder(order);
-                orderLookup_.emplace(order.id, OrderEntry{ std::prev(level.orders_.end()) });
+            if (!order.isFilled() && isGoodTillCancel(order)) {
+                const OrderHandle handle = orders_.acquire(order);
+                linkResting(handle);
+                orderLookup_.insert(order.id, OrderEntry{ handle });
+                resting = true;
             }
         } else {
-            trades = matchMarketOrder(order);
+            matchMarketOrder(order, sink);
         }
 
-        return trades;
+        fireStops(sink);
+        publishLevelUpdates();
+        return OrderResult{ remainingBefore - order.getRemainingQuantity(), RejectReason::NONE, resting };
     }
 
-    bool cancelOrder(OrderId orderId) {
-        auto orderIt = orderLookup_.find(orderId);
-        if (orderIt == orderLookup_.end()) return false;
+    OrderResult cancelOrder(OrderId orderId) noexcept {
+        [[maybe_unused]] auto timer = startTimer<&OrderBookStats::cancelNanos>();
+        const OrderEntry* entry = orderLookup_.find(orderId);
+        if (!entry) return OrderResult::rejected(RejectReason::UNKNOWN_ID);
 
-        const auto& entry = orderIt->second;
-        const Order& order = *entry.location_;
+        const OrderHandle handle = entry->location_;
+        if (isStop(orders_[handle])) unlinkStop(handle);
+        else unlinkResting(handle);
+        orderLookup_.erase(orderId);
+        orders_.release(handle);
 
-        auto removeFromBook = [&](auto& book) {
-            auto levelIt = book.find(order.price);
-            if (levelIt == book.end()) throw std::logic_error("no level in book found!");
-            PriceLevel& level = levelIt->second;
-            level.removeOrder(entry.location_);
-            if (level.isEmpty()) book.erase(levelIt);
-        };
+        publishLevelUpdates();
+        return OrderResult{};
+    }
 
-        if (order.side == Side::BUY) {
-            removeFromBook(bids_);
+    // Mass cancels, for session end and kill switches. Each cancelled id is passed to sink, in
+    // no particular order, and the emptied levels are dropped whole: one pass over the orders
+    // plus O(levels), not an id lookup, level find and unlink per order. A level update
+    // handler gets one REMOVE per level, in a single batch. Each returns the number of orders
+    // cancelled.
+
+    // Every resting order and pending stop. The ids are read straight off the id index, in its
+    // order rather than by price, and the index, pool and ladders are then emptied wholesale
+    // without touching the orders: sequential passes over their capacity.
+    template <CancelSink Sink>
+    std::size_t cancelAll(Sink&& sink) noexcept {
+        const std::size_t cancelled = orderLookup_.size();
+        orderLookup_.forEach([&sink](std::uint64_t id, const OrderEntry&) { sink(id); });
+        if (orderEventHandler_) orderEvents_.push_back(OrderEvent{ 0, 0, 0, 0, Side::BUY, OrderEventAction::CLEAR });
+        recordRemoved(bids_, Side::BUY);
+        recordRemoved(asks_, Side::SELL);
+        bids_.clear();
+        asks_.clear();
+        buyStops_.clear();
+        sellStops_.clear();
+        pendingStops_ = 0;
+        orderLookup_.clear();
+        orders_.clear();
+        publishLevelUpdates();
+        return cancelled;
+    }
+
+    // Every resting order on one side, then that side's pending stops.
+    template <CancelSink Sink>
+    std::size_t cancelSide(Side side, Sink&& sink) noexcept {
+        const std::size_t cancelled = side == Side::BUY ? dropSide(bids_, side, sink) + dropStops(buyStops_, sink)
+                                                        : dropSide(asks_, side, sink) + dropStops(sellStops_, sink);
+        publishLevelUpdates();
+        return cancelled;
+    }
+
+    // Resting orders on one side priced within [low, high]; pending stops are left alone. The
+    // levels ahead of the range are stepped over to reach it.
+    template <CancelSink Sink>
+    std::size_t cancelPriceRange(Side side, Price low, Price high, Sink&& sink) noexcept {
+        const std::size_t cancelled = side == Side::BUY ? dropRange(bids_, side, low, high, sink) : dropRange(asks_, side, low, high, sink);
+        publishLevelUpdates();
+        return cancelled;
+    }
+
+    OrderResult modifyOrder(const OrderModify& order, std::vector<Trade>& trades) noexcept {
+        return modifyOrder(order, [&trades](const Trade& trade) { trades.push_back(trade); });
+    }
+
+    // Amends a resting order with a single id lookup. Shrinking (or keeping) the quantity at
+    // the same price is done in place and keeps queue priority; any other change re-matches
+    // the order at its new terms and requeues the same pool slot at the back of its level.
+    // A quantity of 0 cancels the order. Pending stops can only be cancelled.
+    template <TradeSink Sink>
+    OrderResult modifyOrder(const OrderModify& order, Sink&& sink) noexcept {
+        [[maybe_unused]] auto timer = startTimer<&OrderBookStats::modifyNanos>();
+        const OrderEntry* entry = orderLookup_.find(order.id_);
+        if (!entry) return OrderResult::rejected(RejectReason::UNKNOWN_ID);
+
+        const OrderHandle handle = entry->location_;
+        Order& standingOrder = orders_[handle];
+        if (isStop(standingOrder)) return OrderResult::rejected(RejectReason::UNSUPPORTED);
+        OrderResult result{ 0, RejectReason::NONE, true };
+
+        if (order.quantity_ == 0) {
+            unlinkResting(handle);
+            orderLookup_.erase(order.id_);
+            orders_.release(handle);
+            result.resting = false;
+        } else if (order.price_ == standingOrder.price && order.quantity_ <= standingOrder.getRemainingQuantity()) {
+            const Quantity released = standingOrder.getRemainingQuantity() - order.quantity_;
+            // Same price and size: nothing changes, so nothing is published.
+            if (released == 0) return result;
+            Level& level = levelOf(standingOrder);
+            level.reduceOrder(orders_, handle, released);
+            removeLiquidity(standingOrder.side, standingOrder.price, released);
+            standingOrder.quantity = order.quantity_;
+            standingOrder.remainingQuantity = order.quantity_;
+            recordLevel(standingOrder.side, standingOrder.price, level, LevelAction::CHANGE);
+            recordOrder(standingOrder, OrderEventAction::REDUCE);
         } else {
-            removeFromBook(asks_);
+            unlinkResting(handle);
+            standingOrder.price = order.price_;
+            standingOrder.quantity = order.quantity_;
+            standingOrder.remainingQuantity = order.quantity_;
+
+            matchLimitOrder(standingOrder, sink);
+            result.filledQuantity = standingOrder.getFilledQuantity();
+
+            if (standingOrder.isFilled()) {
+                orderLookup_.erase(order.id_);
+                orders_.release(handle);
+                result.resting = false;
+            } else {
+                linkResting(handle);
+            }
         }
 
-        orderLookup_.erase(orderIt);
-        return true;
+        fireStops(sink);
+        publishLevelUpdates();
+        return result;
     }
 
-    std::vector<Trade> modifyOrder(const OrderModify& order) {
-        auto it = orderLookup_.find(order.id_);
-        if (it == orderLookup_.end()) throw std::logic_error("order doesnt exist");
+    // Cache hints for batched callers running a few commands ahead: prefetchIndex starts
+    // loading the id-index slot for id; prefetchOrder, issued once that slot has had time to
+    // arrive, starts loading the resting order it points at. Neither changes the book.
+    void prefetchIndex(OrderId id) const { orderLookup_.prefetch(id); }
 
-        const auto& standingOrder = *it->second.location_;
-        Order updatedOrder = order.toOrder(standingOrder.side, standingOrder.type, standingOrder.tif);
-        cancelOrder(order.id_);
-        return addOrder(updatedOrder);
+    void prefetchOrder(OrderId id) const {
+        if (const OrderEntry* entry = orderLookup_.find(id)) orders_.prefetch(entry->location_);
     }
 
-    // Query methods - (Public interface)
-    std::optional<Price> getBestBid() const {
-        if (bids_.empty()) return std::nullopt;
-        return bids_.begin()->first;
+    // Called once per inbound command with that command's level changes, in order.
+    // Keeping a mirror of the book then costs O(changes) instead of a depth rebuild per poll.
+    void setLevelUpdateHandler(LevelUpdateHandler handler) {
+        levelUpdateHandler_ = std::move(handler);
+        levelUpdates_.clear();
+        levelUpdates_.reserve(64);
     }
 
-    std::optional<Price> getBestAsk() const {
-        if (asks_.empty()) return std::nullopt;
-        return asks_.begin()->first;
+    // Called once per inbound command with that command's order events, in order, just before
+    // its level updates. Orders already resting when the handler is set are not replayed.
+    void setOrderEventHandler(OrderEventHandler handler) {
+        orderEventHandler_ = std::move(handler);
+        orderEvents_.clear();
+        orderEvents_.reserve(64);
     }
 
+    // Query methods - (Public interface)
+    std::optional<Price> getBestBid() const { return bids_.bestPrice(); }
+    std::optional<Price> getBestAsk() const { return asks_.bestPrice(); }
+
     std::optional<Price> getSpread() const {
         auto bid = getBestBid();
         auto ask = getBestAsk();
@@ -184,129 +559,557 @@ public:
 
     Quantity getVolumeAtPrice(Price price, Side side) const {
         auto getSideVolume = [&](auto& orderSide) -> Quantity {
-            auto it = orderSide.find(price);
-            return (it == orderSide.end()) ? 0 : it->second.getTotalVolume();
+            const Level* level = orderSide.find(price);
+            return level ? level->getTotalVolume() : 0;
         };
         return side == Side::BUY ? getSideVolume(bids_) : getSideVolume(asks_);
     }
 
-    // Market data
-    struct BookLevel {
-        Price price;
-        Quantity volume;
-        BookLevel(Price p, Quantity v) : price(p), volume(v) {}
-    };
+    // Resting volume on one side from its best price through price: bids at or above it, asks
+    // at or below it. O(log ticks) for prices inside the dense band.
+    Quantity getVolumeUpTo(Price price, Side side) const {
+        return side == Side::BUY ? bids_.volumeUpTo(price) : asks_.volumeUpTo(price);
+    }
+
+    // Worst price reached by sweeping quantity from one side, or nullopt if it holds less.
+    std::optional<Price> getPriceForVolume(Quantity quantity, Side side) const {
+        return side == Side::BUY ? bids_.priceForVolume(quantity) : asks_.priceForVolume(quantity);
+    }
 
+    // Market data
     std::vector<BookLevel> getBidDepth(size_t levels) const { return getDepthFrom(bids_, levels); }
     std::vector<BookLevel> getAskDepth(size_t levels) const { return getDepthFrom(asks_, levels); }
 
+    // Visits one side's levels best first without allocating; fn(price, volume) returns false to stop.
+    template <typename Fn>
+    void forEachLevel(Side side, Fn&& fn) const {
+        auto visit = [&fn](Price price, const Level& level) { return fn(price, level.getTotalVolume()); };
+        if (side == Side::BUY) bids_.forEach(visit);
+        else asks_.forEach(visit);
+    }
+
+    // Price of the most recent trade, which is what stops trigger on; nullopt before the first.
+    std::optional<Price> getLastTradePrice() const { return lastTradePrice_; }
+
     // Statistics
-    size_t getOrderCount() const { return orderLookup_.size(); }
+    size_t getOrderCount() const { return orderLookup_.size() - pendingStops_; }
+    size_t getPendingStopCount() const { return pendingStops_; }
+    // True when nothing is resting and no stop is pending.
     bool isEmpty() const { return orderLookup_.empty(); }
+    typename OrderStorage::Stats getOrderPoolStats() const { return orders_.getStats(); }
+
+    // Copy of the histograms collected since construction or the last resetStats().
+    OrderBookStats getStats() const {
+        if constexpr (kStatsEnabled) return stats_;
+        else return {};
+    }
+
+    void resetStats() {
+        if constexpr (kStatsEnabled) stats_ = OrderBookStats{};
+    }
+
+    // The policy's trade analytics stage, e.g. to advance its clock or read its totals.
+    Analytics& getAnalytics() { return analytics_; }
+    const Analytics& getAnalytics() const { return analytics_; }
+
+    // Moves both dense bands to start at base, e.g. when the market drifts away. O(levels).
+    void rebaseLadder(Price base) {
+        bids_.rebase(base);
+        asks_.rebase(base);
+        buyStops_.rebase(base);
+        sellStops_.rebase(base);
+    }
 
 private:
-    std::map<Price, PriceLevel, std::greater<Price>> bids_;
-    std::map<Price, PriceLevel> asks_;
-    std::unordered_map<OrderId, OrderEntry> orderLookup_;
+    friend class BookSnapshot;
+
+    struct NoStats {};
+    struct NoTimer {};
+
+    static constexpr std::size_t kDropLanes = 8;
+
+    BidLadder bids_;
+    AskLadder asks_;
+    OrderStorage orders_;
+    IdIndex orderLookup_;
+    BuyStopLadder buyStops_;
+    SellStopLadder sellStops_;
+    std::size_t pendingStops_ = 0;
+    std::optional<Price> lastTradePrice_;
+    // Range of trade prices since fireStops last looked, and the stops it is about to activate.
+    bool traded_ = false;
+    Price tradeLow_ = 0;
+    Price tradeHigh_ = 0;
+    std::vector<OrderHandle> triggered_;
+    // Levels a mass cancel is about to empty, and for a price range their prices.
+    std::vector<Level*> droppedLevels_;
+    std::vector<PriceLevel*> droppedStops_;
+    std::vector<Price> rangePrices_;
+    LevelUpdateHandler levelUpdateHandler_;
+    std::vector<LevelUpdate> levelUpdates_;
+    OrderEventHandler orderEventHandler_;
+    std::vector<OrderEvent> orderEvents_;
+    [[no_unique_address]] std::conditional_t<kStatsEnabled, OrderBookStats, NoStats> stats_;
+    [[no_unique_address]] Analytics analytics_;
+
+    static IdIndex makeIdIndex(const OrderBookConfig& config) {
+        if constexpr (std::is_constructible_v<IdIndex, IdIndexKind, std::size_t>) return IdIndex(config.idIndex, config.idWindow);
+        else if constexpr (std::is_same_v<IdIndex, DenseIdIndex<OrderEntry>>) return IdIndex(config.idWindow);
+        else return IdIndex();
+    }
+
+    // Times the rest of the enclosing scope into one of the stats histograms, if stats are on.
+    template <Histogram OrderBookStats::*Field>
+    auto startTimer() {
+        if constexpr (kStatsEnabled) return ScopedLatency(stats_.*Field);
+        else return NoTimer{};
+    }
+
+    // Order kinds outside the policy never get past supports(), so with a feature off these
+    // fold to constants and the branches for it drop out of addOrder.
+    static bool supports(const Order& order) {
+        if (order.type == OrderType::MARKET) return Policy::kMarketOrders;
+        if (order.type == OrderType::STOP) return Policy::kStopOrders && Policy::kMarketOrders;
+        if (order.type == OrderType::STOP_LIMIT && !Policy::kStopOrders) return false;
+        switch (order.tif) {
+        case TimeInForce::GTC: return true;
+        case TimeInForce::IOC: return Policy::kImmediateOrCancel;
+        case TimeInForce::FOK: return Policy::kFillOrKill;
+        }
+        return false;
+    }
 
+    static bool isLimit(const Order& order) {
+        if constexpr (Policy::kMarketOrders) return order.type == OrderType::LIMIT;
+        else return true;
+    }
+
+    static bool isFillOrKill(const Order& order) {
+        if constexpr (Policy::kFillOrKill) return order.tif == TimeInForce::FOK;
+        else return false;
+    }
+
+    static bool isStop(const Order& order) {
+        if constexpr (Policy::kStopOrders) return order.type == OrderType::STOP || order.type == OrderType::STOP_LIMIT;
+        else return false;
+    }
+
+    static bool isGoodTillCancel(const Order& order) {
+        if constexpr (Policy::kImmediateOrCancel || Policy::kFillOrKill) return order.tif == TimeInForce::GTC;
+        else return true;
+    }
 
     template <typename BookMap>
     std::vector<BookLevel> getDepthFrom(const BookMap& book, size_t levels) const {
         std::vector<BookLevel> depth;
         depth.reserve(std::min(levels, book.size()));
-        for (auto it = book.begin(); levels > 0 && it != book.end(); --levels, ++it) {
-            depth.emplace_back(it->first, it->second.getTotalVolume());
-        }
+        if (levels == 0) return depth;
+        book.forEach([&](Price price, const Level& level) {
+            depth.emplace_back(price, level.getTotalVolume());
+            return depth.size() < levels;
+        });
         return depth;
     }
 
+    // Only called for resting orders, which always have a level.
+    Level& levelOf(const Order& order) {
+        return *((order.side == Side::BUY) ? bids_.find(order.price) : asks_.find(order.price));
+    }
+
+    // Queues a pooled order at the back of the level for its side and price.
+    void linkResting(OrderHandle handle) {
+        const Order& order = orders_[handle];
+        Level& level = (order.side == Side::BUY) ? bids_.getOrCreate(order.price) : asks_.getOrCreate(order.price);
+        const LevelAction action = level.isEmpty() ? LevelAction::ADD : LevelAction::CHANGE;
+        level.addOrder(orders_, handle);
+        addLiquidity(order.side, order.price, order.getRemainingQuantity());
+        recordLevel(order.side, order.price, level, action);
+        recordOrder(order, OrderEventAction::ADD);
+    }
+
+    // Takes a resting order out of its level (dropping the level if it empties) but keeps
+    // its pool slot and index entry.
+    void unlinkResting(OrderHandle handle) {
+        const Order& order = orders_[handle];
+        const Price price = order.price;
+        Level& level = levelOf(order);
+        recordOrder(order, OrderEventAction::REMOVE);
+        removeLiquidity(order.side, price, order.getRemainingQuantity());
+        level.removeOrder(orders_, handle);
+        if (level.isEmpty()) {
+            recordLevel(order.side, price, level, LevelAction::REMOVE);
+            if (order.side == Side::BUY) bids_.erase(price);
+            else asks_.erase(price);
+        } else {
+            recordLevel(order.side, price, level, LevelAction::CHANGE);
+        }
+    }
+
+    // Keeps the ladders' cumulative-volume indexes in step with every level volume change.
+    void addLiquidity(Side side, Price price, Quantity quantity) {
+        if (side == Side::BUY) bids_.addVolume(price, quantity);
+        else asks_.addVolume(price, quantity);
+    }
+
+    void removeLiquidity(Side side, Price price, Quantity quantity) {
+        if (side == Side::BUY) bids_.removeVolume(price, quantity);
+        else asks_.removeVolume(price, quantity);
+    }
+
+    void recordLevel(Side side, Price price, const Level& level, LevelAction action) {
+        recordLevel(side, price, level.getTotalVolume(), action);
+    }
+
+    void recordLevel(Side side, Price price, Quantity volume, LevelAction action) {
+        if (!levelUpdateHandler_) return;
+
+        const LevelUpdate update{ price, volume, side, action };
+        if (levelUpdates_.empty()) {
+            levelUpdates_.push_back(update);
+            return;
+        }
+
+        // Fold repeated touches of the same level within a command into one event.
+        LevelUpdate& last = levelUpdates_.back();
+        if (last.price != price || last.side != side) {
+            levelUpdates_.push_back(update);
+        } else if (last.action == LevelAction::ADD && action == LevelAction::REMOVE) {
+            levelUpdates_.pop_back();
+        } else {
+            last.volume = update.volume;
+            if (last.action == LevelAction::REMOVE && action == LevelAction::ADD) last.action = LevelAction::CHANGE;
+            else if (last.action != LevelAction::ADD) last.action = action;
+        }
+    }
+
+    void recordOrder(const Order& order, OrderEventAction action) {
+        if (!orderEventHandler_) return;
+        orderEvents_.push_back(OrderEvent{ order.id, 0, order.price, order.getRemainingQuantity(), order.side, action });
+    }
+
+    // Order events go out first, so a consumer applying both sees the orders behind a level change.
+    void publishLevelUpdates() {
+        if (!orderEvents_.empty()) {
+            orderEventHandler_(std::span<const OrderEvent>(orderEvents_));
+            orderEvents_.clear();
+        }
+        if (levelUpdates_.empty()) return;
+        levelUpdateHandler_(std::span<const LevelUpdate>(levelUpdates_));
+        levelUpdates_.clear();
+    }
+
     bool canFullyMatch(const Order& order) const {
-        Quantity requiredQty = order.getRemainingQuantity();
-        Quantity availableQty = 0;
+        const Quantity available = order.side == Side::BUY ? asks_.volumeUpTo(order.price) : bids_.volumeUpTo(order.price);
+        return available >= order.getRemainingQuantity();
+    }
 
-        if (order.side == Side::BUY) {
-            // Match against Asks
-            for (const auto& [price, level] : asks_) {
-                if (price > order.price) break;
-                availableQty += level.getTotalVolume();
-                if (availableQty >= requiredQty) return true;
+    bool stopCrossed(const Order& order) const {
+        if (!lastTradePrice_) return false;
+        return order.side == Side::BUY ? *lastTradePrice_ >= order.stopPrice : *lastTradePrice_ <= order.stopPrice;
+    }
+
+    // A stop the last trade has already crossed enters straight away; any other waits in the
+    // trigger book under its id until fireStops reaches it.
+    template <typename Sink>
+    OrderResult addStop(Order& order, Sink& sink) {
+        if (orderLookup_.find(order.id)) return OrderResult::rejected(RejectReason::DUPLICATE_ID);
+
+        const OrderHandle handle = orders_.acquire(order);
+        orderLookup_.insert(order.id, OrderEntry{ handle });
+        if (!stopCrossed(order)) {
+            linkStop(handle);
+            return OrderResult{ 0, RejectReason::NONE, true };
+        }
+
+        const OrderResult result = activateStop(handle, sink);
+        if (!result.accepted()) return result;
+        order.fill(result.filledQuantity);
+        fireStops(sink);
+        publishLevelUpdates();
+        return result;
+    }
+
+    // Turns a triggered stop into the market or limit order it stands for and runs it like a
+    // new one; a limit that rests keeps the stop's pool slot and id entry.
+    template <typename Sink>
+    OrderResult activateStop(OrderHandle handle, Sink& sink) {
+        Order& order = orders_[handle];
+        bool resting = false;
+        if (order.type == OrderType::STOP) {
+            order.type = OrderType::MARKET;
+            matchMarketOrder(order, sink);
+        } else {
+            order.type = OrderType::LIMIT;
+            if (isFillOrKill(order) && !canFullyMatch(order)) {
+                orderLookup_.erase(order.id);
+                orders_.release(handle);
+                return OrderResult::rejected(RejectReason::FOK_UNFILLABLE);
             }
+            matchLimitOrder(order, sink);
+            resting = !order.isFilled() && isGoodTillCancel(order);
+        }
+
+        const Quantity filled = order.getFilledQuantity();
+        if (resting) {
+            linkResting(handle);
         } else {
-            // Match against Bids
-            for (const auto& [price, level] : bids_) {
-                if (price < order.price) break;
-                availableQty += level.getTotalVolume();
-                if (availableQty >= requiredQty) return true;
+            orderLookup_.erase(order.id);
+            orders_.release(handle);
+        }
+        return OrderResult{ filled, RejectReason::NONE, resting };
+    }
+
+    // Pending stops queue by trigger price in their own ladders, which never reach the L2 feed.
+    void linkStop(OrderHandle handle) {
+        const Order& order = orders_[handle];
+        auto link = [&](auto& ladder) {
+            ladder.getOrCreate(order.stopPrice).addOrder(orders_, handle);
+            ladder.addVolume(order.stopPrice, order.getRemainingQuantity());
+        };
+        if (order.side == Side::BUY) link(buyStops_);
+        else link(sellStops_);
+        ++pendingStops_;
+    }
+
+    void unlinkStop(OrderHandle handle) {
+        const Order& order = orders_[handle];
+        auto unlink = [&](auto& ladder) {
+            PriceLevel& level = *ladder.find(order.stopPrice);
+            ladder.removeVolume(order.stopPrice, order.getRemainingQuantity());
+            level.removeOrder(orders_, handle);
+            if (level.isEmpty()) ladder.erase(order.stopPrice);
+        };
+        if (order.side == Side::BUY) unlink(buyStops_);
+        else unlink(sellStops_);
+        --pendingStops_;
+    }
+
+    // Activates every pending stop crossed by the trades since the last call: buys from the
+    // lowest trigger up, then sells from the highest down, first in first out at each price.
+    // Their own trades may cross more stops, which fire in the next round, until a round trades
+    // nothing. Only the crossed trigger levels are visited, so with nothing crossed this is a
+    // look at each side's best trigger.
+    template <typename Sink>
+    void fireStops(Sink& sink) {
+        if constexpr (Policy::kStopOrders) {
+            while (traded_) {
+                traded_ = false;
+                if (pendingStops_ == 0) return;
+
+                triggered_.clear();
+                takeCrossedStops(buyStops_, [high = tradeHigh_](Price stop) { return stop <= high; });
+                takeCrossedStops(sellStops_, [low = tradeLow_](Price stop) { return stop >= low; });
+                for (const OrderHandle handle : triggered_) activateStop(handle, sink);
             }
         }
-        return false;
     }
 
-    // Matching engine
-    std::vector<Trade> matchOrder(Order& order) {
-        return order.type == OrderType::LIMIT
-            ? matchLimitOrder(order)
-            : matchMarketOrder(order);
+    template <typename Ladder, typename Crossed>
+    void takeCrossedStops(Ladder& ladder, Crossed&& crossed) {
+        while (!ladder.empty()) {
+            const auto best = ladder.best();
+            if (!crossed(best.price)) return;
+
+            PriceLevel& level = *best.level;
+            level.forEachOrder(orders_, [this](OrderHandle handle) {
+                triggered_.push_back(handle);
+                --pendingStops_;
+            });
+            ladder.removeVolume(best.price, level.getTotalVolume());
+            level = PriceLevel{};
+            ladder.erase(best.price);
+        }
     }
 
-    template <typename BookType, typename Predicate>
-    std::vector<Trade> executeMatching(Order& order, BookType& book, Predicate&& shouldMatchPrice) {
-        std::vector<Trade> trades;
+    // Cancels every order queued at levels and frees their index entries and slots; the levels
+    // are left for the ladder to reset. Linked queues are walked kDropLanes at a time, one order
+    // from each in turn with the next one prefetched, so the cache misses along one chain
+    // overlap with the others' instead of being taken one after another. Pending stops (resting
+    // false) are left out of the order event feed.
+    template <typename LevelType, typename Sink>
+    std::size_t dropQueued(std::span<LevelType* const> levels, Sink& sink, bool resting) {
+        std::size_t cancelled = 0;
+        auto drop = [&](OrderHandle handle) {
+            const OrderId id = orders_[handle].id;
+            if (resting) recordOrder(orders_[handle], OrderEventAction::REMOVE);
+            sink(id);
+            orderLookup_.erase(id);
+            orders_.release(handle);
+            ++cancelled;
+        };
 
+        if constexpr (requires(const LevelType& level) { level.front(); }) {
+            std::array<OrderHandle, kDropLanes> lanes;
+            lanes.fill(kInvalidHandle);
+            std::size_t nextLevel = 0;
+            for (bool busy = true; busy;) {
+                busy = false;
+                for (OrderHandle& lane : lanes) {
+                    while (lane == kInvalidHandle && nextLevel < levels.size()) lane = levels[nextLevel++]->front();
+                    if (lane == kInvalidHandle) continue;
+                    const OrderHandle handle = lane;
+                    lane = orders_.next(handle);
+                    if (lane != kInvalidHandle) orders_.prefetch(lane);
+                    drop(handle);
+                    busy = true;
+                }
+            }
+        } else {
+            for (LevelType* level : levels) level->forEachOrder(orders_, drop);
+        }
+        return cancelled;
+    }
+
+    template <typename Ladder>
+    void recordRemoved(const Ladder& ladder, Side side) {
+        if (!levelUpdateHandler_) return;
+        ladder.forEach([&](Price price, const Level&) {
+            recordLevel(side, price, Quantity{ 0 }, LevelAction::REMOVE);
+            return true;
+        });
+    }
+
+    template <typename Ladder, typename Sink>
+    std::size_t dropSide(Ladder& ladder, Side side, Sink& sink) {
+        droppedLevels_.clear();
+        ladder.forEach([&](Price, Level& level) {
+            droppedLevels_.push_back(&level);
+            return true;
+        });
+        const std::size_t cancelled = dropQueued(std::span<Level* const>(droppedLevels_), sink, true);
+        recordRemoved(ladder, side);
+        ladder.clear();
+        return cancelled;
+    }
+
+    template <typename Ladder, typename Sink>
+    std::size_t dropStops(Ladder& ladder, Sink& sink) {
+        droppedStops_.clear();
+        ladder.forEach([&](Price, PriceLevel& level) {
+            droppedStops_.push_back(&level);
+            return true;
+        });
+        const std::size_t cancelled = dropQueued(std::span<PriceLevel* const>(droppedStops_), sink, false);
+        ladder.clear();
+        pendingStops_ -= cancelled;
+        return cancelled;
+    }
+
+    // Levels come in priority order, so the walk stops at the first one past the range.
+    template <typename Ladder, typename Sink>
+    std::size_t dropRange(Ladder& ladder, Side side, Price low, Price high, Sink& sink) {
+        rangePrices_.clear();
+        droppedLevels_.clear();
+        ladder.forEach([&](Price price, Level& level) {
+            if (side == Side::BUY ? price < low : price > high) return false;
+            if (price >= low && price <= high) {
+                rangePrices_.push_back(price);
+                droppedLevels_.push_back(&level);
+                ladder.removeVolume(price, level.getTotalVolume());
+            }
+            return true;
+        });
+
+        const std::size_t cancelled = dropQueued(std::span<Level* const>(droppedLevels_), sink, true);
+        for (const Price price : rangePrices_) {
+            ladder.erase(price);
+            recordLevel(side, price, Quantity{ 0 }, LevelAction::REMOVE);
+        }
+        return cancelled;
+    }
+
+    void noteTrade(Price price) {
+        lastTradePrice_ = price;
+        if constexpr (Policy::kStopOrders) {
+            if (!traded_) {
+                traded_ = true;
+                tradeLow_ = price;
+                tradeHigh_ = price;
+            } else {
+                tradeLow_ = std::min(tradeLow_, price);
+                tradeHigh_ = std::max(tradeHigh_, price);
+            }
+        }
+    }
+
+    // Matching engine
+    template <typename BookType, typename Predicate, typename Sink>
+    void executeMatching(Order& order, BookType& book, Predicate&& shouldMatchPrice, Sink& sink) {
+        [[maybe_unused]] const std::uint64_t started = kStatsEnabled ? latency_clock::now() : 0;
+        [[maybe_unused]] std::uint64_t levelsSwept = 0;
+        [[maybe_unused]] std::uint64_t ordersTouched = 0;
         while (!order.isFilled() && !book.empty()) {
-            auto bestIt = book.begin();
-            Price bestPrice = bestIt->first;
+            auto best = book.best();
+            Price bestPrice = best.price;
 
             if (!shouldMatchPrice(bestPrice)) break;
 
-            PriceLevel& level = bestIt->second;
+            Level& level = *best.level;
+            if constexpr (kStatsEnabled) ++levelsSwept;
 
-            // Match against all orders at this price level
-            while (!level.orders_.empty() && !order.isFilled()) {
-                Order& standingOrder = level.orders_.front();
-                Quantity fillQty = std::min(order.getRemainingQuantity(), standingOrder.getRemainingQuantity());
+            // Match against the orders at this price level, oldest first
+            const bool aggressorBuys = order.side == Side::BUY;
+            [[maybe_unused]] std::uint64_t levelFills = 0;
+            const Quantity levelFilled = level.match(orders_, order.getRemainingQuantity(),
+                [&](OrderHandle standingHandle, Order& standingOrder, Quantity fillQty) {
+                    order.fill(fillQty);
+                    if constexpr (kStatsEnabled) ++ordersTouched;
+                    if constexpr (kAnalyticsEnabled) ++levelFills;
 
-                order.fill(fillQty);
-                standingOrder.fill(fillQty);
+                    sink(Trade{
+                        aggressorBuys ? order.id : standingOrder.id,
+                        aggressorBuys ? standingOrder.id : order.id,
+                        bestPrice,
+                        fillQty
+                    });
+                    if (orderEventHandler_) {
+                        orderEvents_.push_back(OrderEvent{ standingOrder.id, order.id, bestPrice, fillQty, standingOrder.side, OrderEventAction::FILL });
+                    }
 
-                // Todo: method to reduce volume
-                // remove will not reduce volume and will need to call reduce first in PriceLevel class.
-                level.totalVolume_ -= fillQty;
-
-                trades.push_back(Trade{
-                    order.id,
-                    standingOrder.id,
-                    bestPrice,
-                    fillQty
+                    if (standingOrder.isFilled()) {
+                        orderLookup_.erase(standingOrder.id);
+                        orders_.release(standingHandle);
+                    }
                 });
 
-                if (standingOrder.isFilled()) {
-                    orderLookup_.erase(standingOrder.id);
-                    level.removeFrontOrder();
-                }
+            book.removeVolume(bestPrice, levelFilled);
+            noteTrade(bestPrice);
+            if constexpr (kAnalyticsEnabled) analytics_.recordTrades(bestPrice, levelFilled, levelFills);
+            if (level.isEmpty()) {
+                recordLevel(order.side == Side::BUY ? Side::SELL : Side::BUY, bestPrice, level, LevelAction::REMOVE);
+                book.erase(bestPrice);
+            } else {
+                recordLevel(order.side == Side::BUY ? Side::SELL : Side::BUY, bestPrice, level, LevelAction::CHANGE);
             }
+        }
 
-            if (level.orders_.empty()) {
-                book.erase(bestIt);
+        if constexpr (kStatsEnabled) {
+            if (ordersTouched > 0) {
+                const std::uint64_t ticks = latency_clock::now() - started;
+                stats_.matchNanos.record(static_cast<std::uint64_t>(static_cast<double>(ticks) * latency_clock::nanosPerTick()));
+                stats_.levelsSwept.record(levelsSwept);
+                stats_.ordersTouched.record(ordersTouched);
             }
         }
-
-        return trades;
     }
 
-    std::vector<Trade> matchLimitOrder(Order& order) {
+    template <typename Sink>
+    void matchLimitOrder(Order& order, Sink& sink) {
         if (order.side == Side::BUY) {
-            return executeMatching(order, asks_, [limit = order.price](Price ask) { return ask <= limit; });
+            executeMatching(order, asks_, [limit = order.price](Price ask) { return ask <= limit; }, sink);
         } else {
-            return executeMatching(order, bids_, [limit = order.price](Price bid) { return bid >= limit; });
+            executeMatching(order, bids_, [limit = order.price](Price bid) { return bid >= limit; }, sink);
         }
     }
 
-    std::vector<Trade> matchMarketOrder(Order& order) {
+    template <typename Sink>
+    void matchMarketOrder(Order& order, Sink& sink) {
         if (order.side == Side::BUY) {
-            return executeMatching(order, asks_, [](Price) { return true; });
+            executeMatching(order, asks_, [](Price) { return true; }, sink);
         } else {
-            return executeMatching(order, bids_, [](Price) { return true; });
+            executeMatching(order, bids_, [](Price) { return true; }, sink);
         }
     }
-};
\ No newline at end of file
+};
+
+using OrderBook = BasicOrderBook<>;
@@ -0,0 +1,171 @@
+#pragma once
+#include <array>
+#include <cctype>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include "journal.h"
+
+// Text form of recorded order flow. A flow file uses the journal format (see journal.h), so
+// OrderBookReplay streams it straight from the mapping; CSV is only for import and export.
+//
+// One command per line: type,side,order_type,tif,id,price,quantity[,stop_price]
+//   ADD,BUY,LIMIT,GTC,17,10025,40
+//   ADD,SELL,MARKET,IOC,18,,100
+//   ADD,BUY,STOP_LIMIT,GTC,19,10040,10,10030
+//   CANCEL,,,,17,,
+//   MODIFY,,,,12,9990,25
+// Names are case-insensitive. Cancels only need the id and modifies the id, price and quantity;
+// stop_price is required for STOP and STOP_LIMIT adds and left off every other line.
+// Blank lines, lines starting with '#' and a leading header line are skipped.
+inline constexpr const char* kOrderFlowCsvHeader = "type,side,order_type,tif,id,price,quantity,stop_price";
+
+namespace order_flow_detail {
+    inline constexpr std::array<const char*, 3> kTypeNames = { "ADD", "CANCEL", "MODIFY" };
+    inline constexpr std::array<const char*, 2> kSideNames = { "BUY", "SELL" };
+    inline constexpr std::array<const char*, 4> kOrderTypeNames = { "LIMIT", "MARKET", "STOP", "STOP_LIMIT" };
+    inline constexpr std::array<const char*, 3> kTifNames = { "GTC", "IOC", "FOK" };
+
+    inline std::string_view trim(std::string_view text) {
+        while (!text.empty() && std::isspace(static_cast<unsigned char>(text.front()))) text.remove_prefix(1);
+        while (!text.empty() && std::isspace(static_cast<unsigned char>(text.back()))) text.remove_suffix(1);
+        return text;
+    }
+
+    inline bool sameName(std::string_view text, const char* name) {
+        const std::string_view expected(name);
+        if (text.size() != expected.size()) return false;
+        for (std::size_t i = 0; i < text.size(); ++i) {
+            if (std::toupper(static_cast<unsigned char>(text[i])) != expected[i]) return false;
+        }
+        return true;
+    }
+
+    template <typename Enum, std::size_t N>
+    Enum parseName(std::string_view field, const std::array<const char*, N>& names, const char* what) {
+        for (std::size_t i = 0; i < N; ++i) {
+            if (sameName(field, names[i])) return static_cast<Enum>(i);
+        }
+        throw std::runtime_error(std::string("bad ") + what + " '" + std::string(field) + "'");
+    }
+
+    // "?" for a value outside the table rather than a read past it.
+    template <typename Enum, std::size_t N>
+    const char* nameOf(Enum value, const std::array<const char*, N>& names) {
+        const auto index = static_cast<std::size_t>(static_cast<std::underlying_type_t<Enum>>(value));
+        return index < N ? names[index] : "?";
+    }
+
+    template <typename Int>
+    Int parseNumber(std::string_view field, const char* what) {
+        Int value{};
+        const auto [end, error] = std::from_chars(field.data(), field.data() + field.size(), value);
+        if (field.empty() || error != std::errc{} || end != field.data() + field.size()) {
+            throw std::runtime_error(std::string("bad ") + what + " '" + std::string(field) + "'");
+        }
+        return value;
+    }
+}
+
+// Parses one CSV line; throws std::runtime_error naming the offending field.
+inline Command parseCommandCsv(std::string_view line) {
+    using namespace order_flow_detail;
+
+    std::array<std::string_view, 8> fields{};
+    std::size_t count = 0;
+    while (true) {
+        const std::size_t comma = line.find(',');
+        if (count == fields.size()) throw std::runtime_error("expected at most 8 fields");
+        fields[count++] = trim(line.substr(0, comma));
+        if (comma == std::string_view::npos) break;
+        line.remove_prefix(comma + 1);
+    }
+
+    const CommandType type = parseName<CommandType>(fields[0], kTypeNames, "command type");
+    auto field = [&](std::size_t index) { return index < count ? fields[index] : std::string_view{}; };
+
+    switch (type) {
+    case CommandType::ADD: {
+        const OrderType orderType = parseName<OrderType>(field(2), kOrderTypeNames, "order type");
+        const bool stop = orderType == OrderType::STOP || orderType == OrderType::STOP_LIMIT;
+        const bool priced = orderType == OrderType::LIMIT || orderType == OrderType::STOP_LIMIT;
+        const std::string_view price = field(5);
+        return Command{
+            type,
+            parseName<Side>(field(1), kSideNames, "side"),
+            orderType,
+            parseName<TimeInForce>(field(3), kTifNames, "time in force"),
+            parseNumber<OrderId>(field(4), "id"),
+            !priced && price.empty() ? 0 : parseNumber<Price>(price, "price"),
+            parseNumber<Quantity>(field(6), "quantity"),
+            stop ? parseNumber<Price>(field(7), "stop price") : 0
+        };
+    }
+    case CommandType::CANCEL:
+        return Command::cancel(parseNumber<OrderId>(field(4), "id"));
+    case CommandType::MODIFY:
+        return Command::modify(OrderModify{ parseNumber<OrderId>(field(4), "id"), parseNumber<Price>(field(5), "price"),
+            parseNumber<Quantity>(field(6), "quantity") });
+    }
+    throw std::runtime_error("bad command type");
+}
+
+inline void writeCommandCsv(std::ostream& out, const Command& command) {
+    using namespace order_flow_detail;
+
+    out << nameOf(command.type, kTypeNames) << ',';
+    switch (command.type) {
+    case CommandType::ADD:
+        out << nameOf(command.side, kSideNames) << ',' << nameOf(command.orderType, kOrderTypeNames) << ','
+            << nameOf(command.tif, kTifNames) << ',' << command.id << ',';
+        if (command.orderType == OrderType::LIMIT || command.orderType == OrderType::STOP_LIMIT) out << command.price;
+        out << ',' << command.quantity;
+        if (command.orderType == OrderType::STOP || command.orderType == OrderType::STOP_LIMIT) out << ',' << command.stopPrice;
+        out << '\n';
+        break;
+    case CommandType::CANCEL:
+        out << ",,," << command.id << ",,\n";
+        break;
+    case CommandType::MODIFY:
+        out << ",,," << command.id << ',' << command.price << ',' << command.quantity << '\n';
+        break;
+    default:
+        out << '\n';
+        break;
+    }
+}
+
+// Appends every command in the CSV stream to the journal; returns how many were written.
+// Errors carry the 1-based line number.
+inline std::uint64_t convertCsvToJournal(std::istream& in, JournalWriter& journal) {
+    std::string line;
+    std::uint64_t lineNumber = 0;
+    std::uint64_t written = 0;
+    while (std::getline(in, line)) {
+        ++lineNumber;
+        const std::string_view text = order_flow_detail::trim(line);
+        if (text.empty() || text.front() == '#') continue;
+        if (lineNumber == 1 && order_flow_detail::sameName(text.substr(0, 4), "TYPE")) continue;
+
+        try {
+            journal.append(parseCommandCsv(text));
+        } catch (const std::runtime_error& e) {
+            throw std::runtime_error("line " + std::to_string(lineNumber) + ": " + e.what());
+        }
+        ++written;
+    }
+    return written;
+}
+
+inline void writeJournalCsv(std::ostream& out, std::span<const JournalRecord> records) {
+    out << kOrderFlowCsvHeader << '\n';
+    for (const JournalRecord& record : records) writeCommandCsv(out, record.toCommand());
+}
@@ -0,0 +1,302 @@
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "prefetch.h"
+
+// Open-addressing hash keyed by 64-bit ids, linear probing with backward-shift deletion,
+// so erases never leave tombstones behind and probe chains stay short under churn.
+// The all-ones key marks empty slots, so an entry under that key is kept beside the table.
+template <typename Value>
+class FlatHashIndex {
+public:
+    static constexpr std::uint64_t kEmptyKey = UINT64_MAX;
+
+    explicit FlatHashIndex(std::size_t expected = 0) { reserve(expected); }
+
+    std::size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    void reserve(std::size_t expected) {
+        if (expected == 0) return;
+        std::size_t capacity = 16;
+        while (capacity < expected * 2) capacity <<= 1;
+        if (capacity > slots_.size()) rehash(capacity);
+    }
+
+    Value* find(std::uint64_t key) {
+        if (key == kEmptyKey) return hasEmptyKey_ ? &emptyKeyValue_ : nullptr;
+        if (slots_.empty()) return nullptr;
+        for (std::size_t i = home(key);; i = (i + 1) & mask_) {
+            Slot& slot = slots_[i];
+            if (slot.key == key) return &slot.value;
+            if (slot.key == kEmptyKey) return nullptr;
+        }
+    }
+
+    const Value* find(std::uint64_t key) const { return const_cast<FlatHashIndex*>(this)->find(key); }
+
+    // Starts loading the slot a lookup of key would probe first.
+    void prefetch(std::uint64_t key) const {
+        if (!slots_.empty()) prefetchForWrite(&slots_[home(key)]);
+    }
+
+    // Returns false (and leaves the existing value) if the key is already present.
+    bool insert(std::uint64_t key, const Value& value) {
+        if (key == kEmptyKey) {
+            if (hasEmptyKey_) return false;
+            emptyKeyValue_ = value;
+            hasEmptyKey_ = true;
+            ++size_;
+            return true;
+        }
+        if ((size_ + 1) * 2 > slots_.size()) rehash(slots_.empty() ? 16 : slots_.size() * 2);
+
+        for (std::size_t i = home(key);; i = (i + 1) & mask_) {
+            Slot& slot = slots_[i];
+            if (slot.key == key) return false;
+            if (slot.key == kEmptyKey) {
+                slot.key = key;
+                slot.value = value;
+                ++size_;
+                return true;
+            }
+        }
+    }
+
+    bool erase(std::uint64_t key) {
+        if (key == kEmptyKey) {
+            if (!hasEmptyKey_) return false;
+            hasEmptyKey_ = false;
+            --size_;
+            return true;
+        }
+        if (slots_.empty()) return false;
+
+        std::size_t hole = home(key);
+        for (;; hole = (hole + 1) & mask_) {
+            if (slots_[hole].key == key) break;
+            if (slots_[hole].key == kEmptyKey) return false;
+        }
+
+        // Pull later members of the cluster back into the hole when that keeps them
+        // reachable from their home slot.
+        for (std::size_t i = (hole + 1) & mask_; slots_[i].key != kEmptyKey; i = (i + 1) & mask_) {
+            const std::size_t want = home(slots_[i].key);
+            if (((i - want) & mask_) >= ((i - hole) & mask_)) {
+                slots_[hole] = slots_[i];
+                hole = i;
+            }
+        }
+        slots_[hole].key = kEmptyKey;
+        --size_;
+        return true;
+    }
+
+    void clear() {
+        for (Slot& slot : slots_) slot.key = kEmptyKey;
+        hasEmptyKey_ = false;
+        size_ = 0;
+    }
+
+    template <typename Fn>
+    void forEach(Fn&& fn) const {
+        for (const Slot& slot : slots_) {
+            if (slot.key != kEmptyKey) fn(slot.key, slot.value);
+        }
+        if (hasEmptyKey_) fn(kEmptyKey, emptyKeyValue_);
+    }
+
+private:
+    struct Slot {
+        std::uint64_t key = kEmptyKey;
+        Value value{};
+    };
+
+    std::vector<Slot> slots_;
+    std::size_t mask_ = 0;
+    int shift_ = 64;
+    std::size_t size_ = 0;
+    bool hasEmptyKey_ = false;
+    Value emptyKeyValue_{};
+
+    // Fibonacci hashing: monotonic ids spread evenly over the table.
+    std::size_t home(std::uint64_t key) const {
+        return static_cast<std::size_t>((key * 0x9E3779B97F4A7C15ULL) >> shift_);
+    }
+
+    void rehash(std::size_t capacity) {
+        std::vector<Slot> old = std::move(slots_);
+        slots_.assign(capacity, Slot{});
+        mask_ = capacity - 1;
+        shift_ = 64 - std::countr_zero(capacity);
+        size_ = hasEmptyKey_ ? 1 : 0;
+        for (const Slot& slot : old) {
+            if (slot.key != kEmptyKey) insert(slot.key, slot.value);
+        }
+    }
+};
+
+// Ring of slots covering the id window [base, base + capacity). Monotonic ids land in the
+// window with a single indexed load; when a new id runs past the end the window slides
+// forward and any orders still resting in the vacated slots move to a FlatHashIndex, which
+// also takes ids that arrive below the window.
+template <typename Value>
+class DenseIdIndex {
+public:
+    explicit DenseIdIndex(std::size_t window = 0)
+        : slots_(window ? std::bit_ceil(window) : 0)
+        , mask_(slots_.empty() ? 0 : slots_.size() - 1)
+    {
+    }
+
+    std::size_t size() const { return live_ + overflow_.size(); }
+    bool empty() const { return size() == 0; }
+
+    void reserve(std::size_t expected) { overflow_.reserve(expected / 8); }
+
+    // Slides the window forward as inserting key would, so a bulk load of unordered ids can
+    // place the highest one first and have the rest land where incremental inserts left them.
+    void advanceTo(std::uint64_t key) {
+        if (!slots_.empty() && key >= base_ && key - base_ >= slots_.size()) slide(key - slots_.size() + 1);
+    }
+
+    Value* find(std::uint64_t key) {
+        if (inWindow(key)) {
+            Slot& slot = slots_[key & mask_];
+            return slot.used ? &slot.value : nullptr;
+        }
+        return overflow_.find(key);
+    }
+
+    const Value* find(std::uint64_t key) const { return const_cast<DenseIdIndex*>(this)->find(key); }
+
+    void prefetch(std::uint64_t key) const {
+        if (inWindow(key)) prefetchForWrite(&slots_[key & mask_]);
+        else overflow_.prefetch(key);
+    }
+
+    bool insert(std::uint64_t key, const Value& value) {
+        if (slots_.empty() || key < base_) return overflow_.insert(key, value);
+        if (key - base_ >= slots_.size()) slide(key - slots_.size() + 1);
+
+        Slot& slot = slots_[key & mask_];
+        if (slot.used) return false;
+        slot.value = value;
+        slot.used = true;
+        ++live_;
+        return true;
+    }
+
+    bool erase(std::uint64_t key) {
+        if (!inWindow(key)) return overflow_.erase(key);
+
+        Slot& slot = slots_[key & mask_];
+        if (!slot.used) return false;
+        slot.used = false;
+        --live_;
+        return true;
+    }
+
+    void clear() {
+        for (Slot& slot : slots_) slot.used = false;
+        live_ = 0;
+        overflow_.clear();
+    }
+
+    template <typename Fn>
+    void forEach(Fn&& fn) const {
+        for (std::uint64_t key = base_; live_ > 0 && key - base_ < slots_.size(); ++key) {
+            const Slot& slot = slots_[key & mask_];
+            if (slot.used) fn(key, slot.value);
+        }
+        overflow_.forEach(fn);
+    }
+
+private:
+    struct Slot {
+        Value value{};
+        bool used = false;
+    };
+
+    std::vector<Slot> slots_;
+    std::size_t mask_ = 0;
+    std::uint64_t base_ = 0;
+    std::size_t live_ = 0;
+    FlatHashIndex<Value> overflow_;
+
+    bool inWindow(std::uint64_t key) const { return key >= base_ && key - base_ < slots_.size(); }
+
+    void slide(std::uint64_t newBase) {
+        const std::uint64_t vacated = std::min<std::uint64_t>(newBase - base_, slots_.size());
+        for (std::uint64_t key = base_; live_ > 0 && key < base_ + vacated; ++key) {
+            Slot& slot = slots_[key & mask_];
+            if (!slot.used) continue;
+            overflow_.insert(key, slot.value);
+            slot.used = false;
+            --live_;
+        }
+        base_ = newBase;
+    }
+};
+
+enum class IdIndexKind { DENSE_WINDOW, FLAT_HASH };
+
+// Order-id lookup chosen at construction: a dense id window for monotonic session ids,
+// or a flat hash for arbitrary ids.
+template <typename Value>
+class OrderIdIndex {
+public:
+    OrderIdIndex(IdIndexKind kind, std::size_t window)
+        : kind_(kind)
+        , dense_(kind == IdIndexKind::DENSE_WINDOW ? window : 0)
+    {
+    }
+
+    IdIndexKind getKind() const { return kind_; }
+
+    std::size_t size() const { return isDense() ? dense_.size() : hash_.size(); }
+    bool empty() const { return size() == 0; }
+
+    void reserve(std::size_t expected) {
+        if (isDense()) dense_.reserve(expected);
+        else hash_.reserve(expected);
+    }
+
+    // Only moves a dense window; see DenseIdIndex::advanceTo.
+    void advanceTo(std::uint64_t key) {
+        if (isDense()) dense_.advanceTo(key);
+    }
+
+    Value* find(std::uint64_t key) { return isDense() ? dense_.find(key) : hash_.find(key); }
+    const Value* find(std::uint64_t key) const { return isDense() ? dense_.find(key) : hash_.find(key); }
+
+    void prefetch(std::uint64_t key) const {
+        if (isDense()) dense_.prefetch(key);
+        else hash_.prefetch(key);
+    }
+    bool insert(std::uint64_t key, const Value& value) { return isDense() ? dense_.insert(key, value) : hash_.insert(key, value); }
+    bool erase(std::uint64_t key) { return isDense() ? dense_.erase(key) : hash_.erase(key); }
+
+    void clear() {
+        dense_.clear();
+        hash_.clear();
+    }
+
+    template <typename Fn>
+    void forEach(Fn&& fn) const {
+        if (isDense()) dense_.forEach(fn);
+        else hash_.forEach(fn);
+    }
+
+private:
+    IdIndexKind kind_;
+    DenseIdIndex<Value> dense_;
+    FlatHashIndex<Value> hash_;
+
+    bool isDense() const { return kind_ == IdIndexKind::DENSE_WINDOW; }
+};
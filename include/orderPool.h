@@ -0,0 +1,131 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "prefetch.h"
+
+using OrderHandle = std::uint32_t;
+inline constexpr OrderHandle kInvalidHandle = UINT32_MAX;
+
+// Slab of fixed-size chunks holding T plus intrusive prev/next links.
+// Handles are stable for the lifetime of an element and released slots are recycled
+// through a free list, so once the pool has grown to the working set it never allocates.
+template <typename T>
+class IntrusivePool {
+    static_assert(std::is_trivially_destructible_v<T>, "live slots are never destroyed individually");
+
+public:
+    struct Stats {
+        std::size_t capacity = 0;
+        std::size_t inUse = 0;
+        std::uint64_t chunkAllocations = 0;
+    };
+
+    explicit IntrusivePool(std::size_t initialCapacity = 0) { reserve(initialCapacity); }
+
+    IntrusivePool(const IntrusivePool&) = delete;
+    IntrusivePool& operator=(const IntrusivePool&) = delete;
+
+    ~IntrusivePool() {
+        for (Node* chunk : chunks_) {
+            std::allocator<Node>{}.deallocate(chunk, kChunkSize);
+        }
+    }
+
+    void reserve(std::size_t capacity) {
+        while (chunks_.size() * kChunkSize < capacity) {
+            addChunk();
+        }
+    }
+
+    template <typename... Args>
+    OrderHandle acquire(Args&&... args) {
+        if (freeHead_ == kInvalidHandle) addChunk();
+
+        const OrderHandle handle = freeHead_;
+        Node& node = nodeAt(handle);
+        freeHead_ = node.next;
+
+        std::construct_at(&node.value, std::forward<Args>(args)...);
+        node.prev = kInvalidHandle;
+        node.next = kInvalidHandle;
+        ++inUse_;
+        return handle;
+    }
+
+    void release(OrderHandle handle) {
+        Node& node = nodeAt(handle);
+        node.next = freeHead_;
+        freeHead_ = handle;
+        --inUse_;
+    }
+
+    // Releases every slot at once and rethreads the free list in ascending order, as if the
+    // chunks were new; any handle still held elsewhere is dangling. O(capacity), one sequential
+    // pass, where releasing each slot in turn would visit them in whatever order they were held.
+    void clear() {
+        freeHead_ = kInvalidHandle;
+        for (std::size_t c = chunks_.size(); c-- > 0;) {
+            const OrderHandle first = static_cast<OrderHandle>(c << kChunkShift);
+            for (std::size_t i = kChunkSize; i-- > 0;) {
+                chunks_[c][i].next = freeHead_;
+                freeHead_ = first + static_cast<OrderHandle>(i);
+            }
+        }
+        inUse_ = 0;
+    }
+
+    T& operator[](OrderHandle handle) { return nodeAt(handle).value; }
+    const T& operator[](OrderHandle handle) const { return nodeAt(handle).value; }
+
+    OrderHandle& next(OrderHandle handle) { return nodeAt(handle).next; }
+    OrderHandle& prev(OrderHandle handle) { return nodeAt(handle).prev; }
+    OrderHandle next(OrderHandle handle) const { return nodeAt(handle).next; }
+    OrderHandle prev(OrderHandle handle) const { return nodeAt(handle).prev; }
+
+    void prefetch(OrderHandle handle) const { prefetchForWrite(&nodeAt(handle)); }
+
+    Stats getStats() const { return Stats{ chunks_.size() * kChunkSize, inUse_, chunkAllocations_ }; }
+
+private:
+    static constexpr std::size_t kChunkShift = 12;
+    static constexpr std::size_t kChunkSize = std::size_t{ 1 } << kChunkShift;
+
+    struct Node {
+        union {
+            T value;
+        };
+        OrderHandle prev;
+        OrderHandle next;
+
+        Node() {}
+        ~Node() {}
+    };
+
+    std::vector<Node*> chunks_;
+    OrderHandle freeHead_ = kInvalidHandle;
+    std::size_t inUse_ = 0;
+    std::uint64_t chunkAllocations_ = 0;
+
+    Node& nodeAt(OrderHandle handle) { return chunks_[handle >> kChunkShift][handle & (kChunkSize - 1)]; }
+    const Node& nodeAt(OrderHandle handle) const { return chunks_[handle >> kChunkShift][handle & (kChunkSize - 1)]; }
+
+    void addChunk() {
+        Node* chunk = std::allocator<Node>{}.allocate(kChunkSize);
+        const OrderHandle first = static_cast<OrderHandle>(chunks_.size() << kChunkShift);
+        chunks_.push_back(chunk);
+        ++chunkAllocations_;
+
+        // Thread the new slots onto the free list in ascending order.
+        for (std::size_t i = kChunkSize; i-- > 0;) {
+            Node* node = std::construct_at(chunk + i);
+            node->prev = kInvalidHandle;
+            node->next = freeHead_;
+            freeHead_ = first + static_cast<OrderHandle>(i);
+        }
+    }
+};
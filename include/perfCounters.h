@@ -0,0 +1,181 @@
+#pragma once
+#include <array>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Events counted for the calling thread, user space only.
+enum class PerfEvent { CYCLES, INSTRUCTIONS, L1D_MISSES, LLC_MISSES, BRANCH_MISSES, DTLB_MISSES, TASK_CLOCK, PAGE_FAULTS };
+
+inline constexpr std::size_t kPerfEventCount = 8;
+
+inline const char* perfEventName(PerfEvent event) {
+    switch (event) {
+    case PerfEvent::CYCLES: return "cycles";
+    case PerfEvent::INSTRUCTIONS: return "instructions";
+    case PerfEvent::L1D_MISSES: return "l1d_misses";
+    case PerfEvent::LLC_MISSES: return "llc_misses";
+    case PerfEvent::BRANCH_MISSES: return "branch_misses";
+    case PerfEvent::DTLB_MISSES: return "dtlb_misses";
+    case PerfEvent::TASK_CLOCK: return "task_clock_ns";
+    case PerfEvent::PAGE_FAULTS: return "page_faults";
+    }
+    return "?";
+}
+
+struct PerfSample {
+    std::array<std::uint64_t, kPerfEventCount> values{};
+
+    std::uint64_t operator[](PerfEvent event) const { return values[static_cast<std::size_t>(event)]; }
+
+    PerfSample& operator+=(const PerfSample& other) {
+        for (std::size_t i = 0; i < kPerfEventCount; ++i) values[i] += other.values[i];
+        return *this;
+    }
+
+    friend PerfSample operator-(PerfSample lhs, const PerfSample& rhs) {
+        for (std::size_t i = 0; i < kPerfEventCount; ++i) lhs.values[i] -= rhs.values[i];
+        return lhs;
+    }
+};
+
+// One perf_event_open group over every event this machine will count. Events the kernel or
+// hardware refuses (no PMU in a VM, perf_event_paranoid, non-Linux) are left out, so callers
+// check has()/available() and report whatever subset came up. A read() is one syscall.
+class PerfCounters {
+public:
+    PerfCounters() {
+#ifdef __linux__
+        for (std::size_t i = 0; i < kPerfEventCount; ++i) open(static_cast<PerfEvent>(i));
+#else
+        error_ = "perf_event_open is Linux-only";
+#endif
+    }
+
+    ~PerfCounters() {
+#ifdef __linux__
+        for (const int fd : fds_) {
+            if (fd >= 0) ::close(fd);
+        }
+#endif
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool available() const { return leader_ >= 0; }
+    bool has(PerfEvent event) const { return fds_[static_cast<std::size_t>(event)] >= 0; }
+
+    // Bit i set when PerfEvent i is being counted.
+    std::uint32_t eventMask() const {
+        std::uint32_t mask = 0;
+        for (std::size_t i = 0; i < kPerfEventCount; ++i) {
+            if (fds_[i] >= 0) mask |= 1u << i;
+        }
+        return mask;
+    }
+
+    // Why the first refused event was refused, e.g. "cycles: No such file or directory".
+    const std::string& getError() const { return error_; }
+
+    // True once the kernel had to time-share the group with other counters; values then
+    // cover only part of the interval.
+    bool wasMultiplexed() const { return multiplexed_; }
+
+    void start() {
+#ifdef __linux__
+        if (leader_ < 0) return;
+        ::ioctl(leader_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ::ioctl(leader_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+    }
+
+    void stop() {
+#ifdef __linux__
+        if (leader_ >= 0) ::ioctl(leader_, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+#endif
+    }
+
+    // Running totals since start(); subtract two reads for an interval.
+    PerfSample read() {
+        PerfSample sample;
+#ifdef __linux__
+        if (leader_ < 0) return sample;
+
+        struct {
+            std::uint64_t count;
+            std::uint64_t timeEnabled;
+            std::uint64_t timeRunning;
+            std::uint64_t values[kPerfEventCount];
+        } buffer{};
+        if (::read(leader_, &buffer, sizeof(buffer)) <= 0) return sample;
+
+        if (buffer.timeRunning < buffer.timeEnabled) multiplexed_ = true;
+        for (std::size_t slot = 0; slot < buffer.count && slot < groupSize_; ++slot) {
+            sample.values[static_cast<std::size_t>(groupOrder_[slot])] = buffer.values[slot];
+        }
+#endif
+        return sample;
+    }
+
+private:
+    std::array<int, kPerfEventCount> fds_ = [] {
+        std::array<int, kPerfEventCount> fds{};
+        fds.fill(-1);
+        return fds;
+    }();
+    std::array<PerfEvent, kPerfEventCount> groupOrder_{};
+    std::size_t groupSize_ = 0;
+    int leader_ = -1;
+    bool multiplexed_ = false;
+    std::string error_;
+
+#ifdef __linux__
+    static bool describe(PerfEvent event, perf_event_attr& attr) {
+        auto cacheMiss = [](std::uint64_t cache) {
+            return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        };
+        switch (event) {
+        case PerfEvent::CYCLES: attr.type = PERF_TYPE_HARDWARE; attr.config = PERF_COUNT_HW_CPU_CYCLES; return true;
+        case PerfEvent::INSTRUCTIONS: attr.type = PERF_TYPE_HARDWARE; attr.config = PERF_COUNT_HW_INSTRUCTIONS; return true;
+        case PerfEvent::L1D_MISSES: attr.type = PERF_TYPE_HW_CACHE; attr.config = cacheMiss(PERF_COUNT_HW_CACHE_L1D); return true;
+        case PerfEvent::LLC_MISSES: attr.type = PERF_TYPE_HW_CACHE; attr.config = cacheMiss(PERF_COUNT_HW_CACHE_LL); return true;
+        case PerfEvent::BRANCH_MISSES: attr.type = PERF_TYPE_HARDWARE; attr.config = PERF_COUNT_HW_BRANCH_MISSES; return true;
+        case PerfEvent::DTLB_MISSES: attr.type = PERF_TYPE_HW_CACHE; attr.config = cacheMiss(PERF_COUNT_HW_CACHE_DTLB); return true;
+        case PerfEvent::TASK_CLOCK: attr.type = PERF_TYPE_SOFTWARE; attr.config = PERF_COUNT_SW_TASK_CLOCK; return true;
+        case PerfEvent::PAGE_FAULTS: attr.type = PERF_TYPE_SOFTWARE; attr.config = PERF_COUNT_SW_PAGE_FAULTS; return true;
+        }
+        return false;
+    }
+
+    void open(PerfEvent event) {
+        perf_event_attr attr{};
+        attr.size = sizeof(attr);
+        if (!describe(event, attr)) return;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        // The leader starts disabled and its members follow it.
+        attr.disabled = leader_ < 0 ? 1 : 0;
+
+        const int fd = static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, leader_, 0));
+        if (fd < 0) {
+            if (error_.empty()) error_ = std::string(perfEventName(event)) + ": " + std::strerror(errno);
+            return;
+        }
+
+        fds_[static_cast<std::size_t>(event)] = fd;
+        groupOrder_[groupSize_++] = event;
+        if (leader_ < 0) leader_ = fd;
+    }
+#endif
+};
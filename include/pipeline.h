@@ -0,0 +1,174 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <thread>
+
+#include "command.h"
+#include "orderBook.h"
+#include "spscRing.h"
+
+enum class OutputType { TRADE, LEVEL_UPDATE, COMMAND_DONE };
+
+// One record on the output ring. COMMAND_DONE closes each command (after its trades and
+// level updates) and carries the ingress timestamp so consumers can measure end-to-end latency.
+struct OutputEvent {
+    OutputType type;
+    bool accepted;
+    std::uint64_t sequence;
+    std::int64_t ingressNanos;
+    union {
+        Trade trade;
+        LevelUpdate level;
+    };
+};
+
+struct PipelineConfig {
+    std::size_t commandRingCapacity = std::size_t{ 1 } << 16;
+    std::size_t outputRingCapacity = std::size_t{ 1 } << 18;
+    // Commands the matching stage takes off the ring per drain.
+    std::size_t matchBatch = 64;
+    OrderBookConfig bookConfig{};
+};
+
+// Three-stage front end for one OrderBook, each stage on its own thread:
+//   decode  -> command ring -> match -> output ring -> publish
+// The decoder pulls commands from the caller's source and stamps them, the matcher drains
+// the command ring in batches into the book, and the publisher hands every trade, level
+// update and command completion to the caller's callback.
+class Pipeline {
+public:
+    // Fills the next command; returns false once the input is exhausted.
+    using Decoder = std::function<bool(Command&)>;
+    using Publisher = std::function<void(const OutputEvent&)>;
+
+    struct Stats {
+        std::uint64_t commands = 0;
+        std::uint64_t outputs = 0;
+        double seconds = 0.0;
+    };
+
+    explicit Pipeline(const PipelineConfig& config = {})
+        : config_(config)
+        , book_(config.bookConfig)
+        , commands_(config.commandRingCapacity)
+        , outputs_(config.outputRingCapacity)
+    {
+    }
+
+    Pipeline(const Pipeline&) = delete;
+    Pipeline& operator=(const Pipeline&) = delete;
+
+    static std::int64_t nowNanos() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+    }
+
+    // Runs all three stages until decoder reports end of input and both rings are drained.
+    Stats run(Decoder decoder, Publisher publisher) {
+        decodeDone_ = false;
+        matchDone_ = false;
+        Stats stats;
+
+        const auto start = Clock::now();
+        std::thread decodeThread([&] { runDecoder(decoder); });
+        std::thread matchThread([&] { stats.commands = runMatcher(); });
+        std::thread publishThread([&] { stats.outputs = runPublisher(publisher); });
+
+        decodeThread.join();
+        matchThread.join();
+        publishThread.join();
+        stats.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        return stats;
+    }
+
+    // Only between runs.
+    const OrderBook& getBook() const { return book_; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr std::size_t kPublishBatch = 256;
+
+    struct StampedCommand {
+        Command command;
+        std::uint64_t sequence;
+        std::int64_t ingressNanos;
+    };
+
+    PipelineConfig config_;
+    OrderBook book_;
+    SpscRing<StampedCommand> commands_;
+    SpscRing<OutputEvent> outputs_;
+    std::atomic<bool> decodeDone_{ false };
+    std::atomic<bool> matchDone_{ false };
+
+    void runDecoder(Decoder& decoder) {
+        StampedCommand stamped{};
+        for (std::uint64_t sequence = 0; decoder(stamped.command); ++sequence) {
+            stamped.sequence = sequence;
+            stamped.ingressNanos = nowNanos();
+            while (!commands_.tryPush(stamped)) std::this_thread::yield();
+        }
+        decodeDone_.store(true, std::memory_order_release);
+    }
+
+    void emit(const OutputEvent& event) {
+        while (!outputs_.tryPush(event)) std::this_thread::yield();
+    }
+
+    std::uint64_t runMatcher() {
+        const StampedCommand* current = nullptr;
+
+        book_.setLevelUpdateHandler([&](std::span<const LevelUpdate> updates) {
+            for (const LevelUpdate& update : updates) {
+                OutputEvent event{ OutputType::LEVEL_UPDATE, true, current->sequence, current->ingressNanos, {} };
+                event.level = update;
+                emit(event);
+            }
+        });
+
+        auto onTrade = [&](const Trade& trade) {
+            OutputEvent event{ OutputType::TRADE, true, current->sequence, current->ingressNanos, {} };
+            event.trade = trade;
+            emit(event);
+        };
+
+        std::uint64_t processed = 0;
+        for (;;) {
+            const std::size_t drained = commands_.consumeBatch(config_.matchBatch, [&](const StampedCommand& stamped) {
+                current = &stamped;
+                const bool accepted = applyCommand(book_, stamped.command, onTrade).accepted();
+                emit(OutputEvent{ OutputType::COMMAND_DONE, accepted, stamped.sequence, stamped.ingressNanos, {} });
+            });
+            processed += drained;
+
+            if (drained == 0) {
+                if (decodeDone_.load(std::memory_order_acquire) && commands_.empty()) break;
+                std::this_thread::yield();
+            }
+        }
+
+        book_.setLevelUpdateHandler({});
+        matchDone_.store(true, std::memory_order_release);
+        return processed;
+    }
+
+    std::uint64_t runPublisher(Publisher& publisher) {
+        std::uint64_t published = 0;
+        for (;;) {
+            const std::size_t drained = outputs_.consumeBatch(kPublishBatch, [&](const OutputEvent& event) {
+                publisher(event);
+            });
+            published += drained;
+
+            if (drained == 0) {
+                if (matchDone_.load(std::memory_order_acquire) && outputs_.empty()) break;
+                std::this_thread::yield();
+            }
+        }
+        return published;
+    }
+};
@@ -0,0 +1,13 @@
+#pragma once
+// Asks the CPU to start pulling the cache line at address in, expecting a write soon.
+// A hint only: it never faults, and compiles to nothing where the builtin is missing.
+inline void prefetchForWrite(const void* address) {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(address, 1, 3);
+    // GCC counts the builtin as side-effect free, so a wrapper it declines to inline is judged
+    // const and every call to it deleted; the empty volatile asm keeps those calls alive.
+    asm volatile("");
+#else
+    (void)address;
+#endif
+}
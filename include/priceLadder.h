@@ -0,0 +1,452 @@
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "fenwickTree.h"
+
+// One side of the book, keyed by price in ticks.
+// Prices inside [base, base + ticks) live in a contiguous slot array with an occupancy
+// bitmap (plus a one-bit-per-word summary) so the best level is a couple of bit scans.
+// Anything outside that band falls back to an ordered tree. With ticks == 0 there is no
+// band at all and the ladder behaves exactly like the plain std::map it replaces.
+//
+// The ladder also keeps a cumulative-volume index: a Fenwick tree of per-word (64-slot) volume
+// over the band, plus running totals for tree levels ahead of and behind the band. The owner
+// reports every change to a level's volume through addVolume/removeVolume, and Level must
+// expose getTotalVolume(). "Volume from the best price through P" and "price where the
+// cumulative volume reaches Q" then cost O(log(ticks / 64)) plus a scan of at most one
+// bitmap word when the answer lies in the band; only the tree parts are walked level by level.
+// Indexing words rather than slots keeps the tree a few cache lines, so updates stay cheap.
+template <typename Key, typename Level, bool Descending>
+class PriceLadder {
+public:
+    using Compare = std::conditional_t<Descending, std::greater<Key>, std::less<Key>>;
+    using Tree = std::map<Key, Level, Compare>;
+
+    struct Entry {
+        Key price;
+        Level* level; // nullptr when the side is empty
+    };
+
+    PriceLadder() = default;
+
+    PriceLadder(Key base, std::size_t ticks)
+        : base_(base)
+        , levels_(ticks)
+        , occupied_((ticks + 63) / 64, 0)
+        , summary_((occupied_.size() + 63) / 64, 0)
+        , bandVolume_(occupied_.size())
+    {
+    }
+
+    bool empty() const { return denseCount_ == 0 && tree_.empty(); }
+    std::size_t size() const { return denseCount_ + tree_.size(); }
+
+    Key getBase() const { return base_; }
+    std::size_t getTicks() const { return levels_.size(); }
+
+    bool inBand(Key price) const {
+        return price >= base_ && static_cast<std::uint64_t>(price - base_) < levels_.size();
+    }
+
+    Level* find(Key price) {
+        if (inBand(price)) {
+            const std::size_t idx = slot(price);
+            return isOccupied(idx) ? &levels_[idx] : nullptr;
+        }
+        auto it = tree_.find(price);
+        return it == tree_.end() ? nullptr : &it->second;
+    }
+
+    const Level* find(Key price) const { return const_cast<PriceLadder*>(this)->find(price); }
+
+    Level& getOrCreate(Key price) {
+        // An empty band is free to follow the market.
+        if (!inBand(price) && denseCount_ == 0 && !levels_.empty()) {
+            rebase(price - static_cast<Key>(levels_.size() / 2));
+        }
+
+        if (inBand(price)) {
+            const std::size_t idx = slot(price);
+            if (!isOccupied(idx)) {
+                setOccupied(idx);
+                ++denseCount_;
+            }
+            return levels_[idx];
+        }
+        return tree_[price];
+    }
+
+    // The level must already be empty. Band levels that own storage keep it for the next
+    // level at that price.
+    void erase(Key price) {
+        if (inBand(price)) {
+            const std::size_t idx = slot(price);
+            if (!isOccupied(idx)) return;
+            clearOccupied(idx);
+            if constexpr (requires(Level& level) { level.clear(); }) levels_[idx].clear();
+            else levels_[idx] = Level{};
+            --denseCount_;
+            return;
+        }
+        tree_.erase(price);
+    }
+
+    // Drops every level at once; the owner has already dealt with their orders. O(levels) plus
+    // a pass over the bitmap words.
+    void clear() {
+        for (std::size_t w = 0; w < occupied_.size(); ++w) {
+            for (std::uint64_t bits = occupied_[w]; bits; bits &= bits - 1) {
+                const std::size_t idx = w * 64 + std::countr_zero(bits);
+                if constexpr (requires(Level& level) { level.clear(); }) levels_[idx].clear();
+                else levels_[idx] = Level{};
+            }
+            occupied_[w] = 0;
+        }
+        std::fill(summary_.begin(), summary_.end(), 0);
+        denseCount_ = 0;
+        tree_.clear();
+        bandVolume_.clear();
+        bandTotal_ = 0;
+        aheadVolume_ = 0;
+        behindVolume_ = 0;
+    }
+
+    Entry best() {
+        auto denseIdx = bestSlot();
+        if (tree_.empty()) {
+            if (!denseIdx) return Entry{ Key{}, nullptr };
+            return Entry{ priceAt(*denseIdx), &levels_[*denseIdx] };
+        }
+
+        auto treeIt = tree_.begin();
+        if (denseIdx && Compare{}(priceAt(*denseIdx), treeIt->first)) {
+            return Entry{ priceAt(*denseIdx), &levels_[*denseIdx] };
+        }
+        return Entry{ treeIt->first, &treeIt->second };
+    }
+
+    std::optional<Key> bestPrice() const {
+        Entry entry = const_cast<PriceLadder*>(this)->best();
+        if (!entry.level) return std::nullopt;
+        return entry.price;
+    }
+
+    void addVolume(Key price, std::uint64_t volume) { shiftVolume(price, volume); }
+    void removeVolume(Key price, std::uint64_t volume) { shiftVolume(price, 0 - volume); }
+
+    // Volume of every level from the best price through price, inclusive.
+    std::uint64_t volumeUpTo(Key price) const {
+        if (levels_.empty() || Compare{}(price, bandHead())) return treeVolumeThrough(tree_.begin(), price);
+        if (inBand(price)) {
+            const std::size_t idx = slot(price);
+            const std::size_t w = idx / 64;
+            const unsigned bit = idx % 64;
+            std::uint64_t band = 0;
+            if constexpr (Descending) {
+                band = bandTotal_ - bandVolume_.prefix(w + 1) + wordVolume(w, ~std::uint64_t{ 0 } << bit);
+            } else {
+                band = bandVolume_.prefix(w) + wordVolume(w, ~std::uint64_t{ 0 } >> (63 - bit));
+            }
+            return aheadVolume_ + band;
+        }
+        return aheadVolume_ + bandTotal_ + treeVolumeThrough(tree_.upper_bound(bandTail()), price);
+    }
+
+    // First price, in priority order, by which the cumulative volume reaches volume; nullopt
+    // when the whole side holds less. A volume of 0 is treated as 1 (the best price).
+    std::optional<Key> priceForVolume(std::uint64_t volume) const {
+        if (volume == 0) volume = 1;
+        if (volume <= aheadVolume_) return treePriceFor(tree_.begin(), volume);
+        volume -= aheadVolume_;
+
+        if (volume <= bandTotal_) {
+            // Find the word the answer lies in, then walk its levels in priority order.
+            if constexpr (Descending) {
+                const std::size_t w = bandVolume_.countWithin(bandTotal_ - volume);
+                std::uint64_t remaining = volume - (bandTotal_ - bandVolume_.prefix(w + 1));
+                for (std::uint64_t bits = occupied_[w]; bits;) {
+                    const std::size_t bit = 63 - std::countl_zero(bits);
+                    bits &= ~(std::uint64_t{ 1 } << bit);
+                    const std::uint64_t level = levels_[w * 64 + bit].getTotalVolume();
+                    if (level >= remaining) return priceAt(w * 64 + bit);
+                    remaining -= level;
+                }
+            } else {
+                const std::size_t w = bandVolume_.countWithin(volume - 1);
+                std::uint64_t remaining = volume - bandVolume_.prefix(w);
+                for (std::uint64_t bits = occupied_[w]; bits; bits &= bits - 1) {
+                    const std::size_t bit = std::countr_zero(bits);
+                    const std::uint64_t level = levels_[w * 64 + bit].getTotalVolume();
+                    if (level >= remaining) return priceAt(w * 64 + bit);
+                    remaining -= level;
+                }
+            }
+            return std::nullopt; // unreachable while the index matches the levels
+        }
+        volume -= bandTotal_;
+
+        if (volume > behindVolume_) return std::nullopt;
+        return treePriceFor(tree_.upper_bound(bandTail()), volume);
+    }
+
+    // Visits levels in priority order; fn(price, level) returns false to stop.
+    template <typename Fn>
+    void forEach(Fn&& fn) { forEachImpl(*this, fn); }
+
+    template <typename Fn>
+    void forEach(Fn&& fn) const { forEachImpl(*this, fn); }
+
+    // Moves the band so it starts at newBase, migrating levels between slots and tree. O(levels).
+    void rebase(Key newBase) {
+        if (levels_.empty()) {
+            base_ = newBase;
+            return;
+        }
+
+        for (std::size_t w = 0; w < occupied_.size(); ++w) {
+            for (std::uint64_t bits = occupied_[w]; bits; bits &= bits - 1) {
+                const std::size_t idx = w * 64 + std::countr_zero(bits);
+                bandVolume_.add(w, 0 - static_cast<std::uint64_t>(levels_[idx].getTotalVolume()));
+                tree_.emplace(priceAt(idx), std::move(levels_[idx]));
+                levels_[idx] = Level{};
+            }
+            occupied_[w] = 0;
+        }
+        std::fill(summary_.begin(), summary_.end(), 0);
+        denseCount_ = 0;
+        bandTotal_ = 0;
+        aheadVolume_ = 0;
+        behindVolume_ = 0;
+        base_ = newBase;
+
+        for (auto it = tree_.begin(); it != tree_.end();) {
+            const Key price = it->first;
+            const std::uint64_t volume = it->second.getTotalVolume();
+            if (!inBand(price)) {
+                shiftVolume(price, volume);
+                ++it;
+                continue;
+            }
+            const std::size_t idx = slot(price);
+            levels_[idx] = std::move(it->second);
+            setOccupied(idx);
+            ++denseCount_;
+            shiftVolume(price, volume);
+            it = tree_.erase(it);
+        }
+    }
+
+private:
+    Key base_ = 0;
+    std::vector<Level> levels_;
+    std::vector<std::uint64_t> occupied_;
+    std::vector<std::uint64_t> summary_;
+    std::size_t denseCount_ = 0;
+    Tree tree_;
+    FenwickTree bandVolume_; // one slot per occupied_ word
+    std::uint64_t bandTotal_ = 0;
+    // Tree levels that rank ahead of / behind every slot. With no band everything is "ahead".
+    std::uint64_t aheadVolume_ = 0;
+    std::uint64_t behindVolume_ = 0;
+
+    std::size_t slot(Key price) const { return static_cast<std::size_t>(price - base_); }
+    Key priceAt(std::size_t idx) const { return base_ + static_cast<Key>(idx); }
+
+    // First and last band prices in priority order.
+    Key bandHead() const { return Descending ? priceAt(levels_.size() - 1) : base_; }
+    Key bandTail() const { return Descending ? base_ : priceAt(levels_.size() - 1); }
+
+    void shiftVolume(Key price, std::uint64_t delta) {
+        if (inBand(price)) {
+            bandVolume_.add(slot(price) / 64, delta);
+            bandTotal_ += delta;
+        } else if (levels_.empty() || Compare{}(price, bandHead())) {
+            aheadVolume_ += delta;
+        } else {
+            behindVolume_ += delta;
+        }
+    }
+
+    // Volume of the occupied slots of word w picked out by mask.
+    std::uint64_t wordVolume(std::size_t w, std::uint64_t mask) const {
+        std::uint64_t volume = 0;
+        for (std::uint64_t bits = occupied_[w] & mask; bits; bits &= bits - 1) {
+            volume += levels_[w * 64 + std::countr_zero(bits)].getTotalVolume();
+        }
+        return volume;
+    }
+
+    template <typename It>
+    std::uint64_t treeVolumeThrough(It it, Key price) const {
+        std::uint64_t volume = 0;
+        for (; it != tree_.end() && !Compare{}(price, it->first); ++it) volume += it->second.getTotalVolume();
+        return volume;
+    }
+
+    template <typename It>
+    std::optional<Key> treePriceFor(It it, std::uint64_t volume) const {
+        std::uint64_t seen = 0;
+        for (; it != tree_.end(); ++it) {
+            seen += it->second.getTotalVolume();
+            if (seen >= volume) return it->first;
+        }
+        return std::nullopt;
+    }
+
+    bool isOccupied(std::size_t idx) const { return (occupied_[idx / 64] >> (idx % 64)) & 1; }
+
+    void setOccupied(std::size_t idx) {
+        const std::size_t w = idx / 64;
+        occupied_[w] |= std::uint64_t{ 1 } << (idx % 64);
+        summary_[w / 64] |= std::uint64_t{ 1 } << (w % 64);
+    }
+
+    void clearOccupied(std::size_t idx) {
+        const std::size_t w = idx / 64;
+        occupied_[w] &= ~(std::uint64_t{ 1 } << (idx % 64));
+        if (occupied_[w] == 0) summary_[w / 64] &= ~(std::uint64_t{ 1 } << (w % 64));
+    }
+
+    std::optional<std::size_t> bestSlot() const {
+        if (denseCount_ == 0) return std::nullopt;
+
+        if constexpr (Descending) {
+            for (std::size_t s = summary_.size(); s-- > 0;) {
+                if (!summary_[s]) continue;
+                const std::size_t w = s * 64 + 63 - std::countl_zero(summary_[s]);
+                return w * 64 + 63 - std::countl_zero(occupied_[w]);
+            }
+        } else {
+            for (std::size_t s = 0; s < summary_.size(); ++s) {
+                if (!summary_[s]) continue;
+                const std::size_t w = s * 64 + std::countr_zero(summary_[s]);
+                return w * 64 + std::countr_zero(occupied_[w]);
+            }
+        }
+        return std::nullopt;
+    }
+
+    // Tree prices are never inside the band, so the tree splits into levels that rank
+    // ahead of every slot and levels that rank behind them.
+    template <typename Self, typename Fn>
+    static void forEachImpl(Self& self, Fn& fn) {
+        auto treeIt = self.tree_.begin();
+        const auto treeEnd = self.tree_.end();
+
+        if (!self.levels_.empty()) {
+            const Key edge = self.bandHead();
+            for (; treeIt != treeEnd && Compare{}(treeIt->first, edge); ++treeIt) {
+                if (!fn(treeIt->first, treeIt->second)) return;
+            }
+
+            if (self.denseCount_ > 0) {
+                const std::size_t words = self.occupied_.size();
+                for (std::size_t n = 0; n < words; ++n) {
+                    const std::size_t w = Descending ? words - 1 - n : n;
+                    for (std::uint64_t bits = self.occupied_[w]; bits;) {
+                        const std::size_t bit = Descending ? 63 - std::countl_zero(bits) : std::countr_zero(bits);
+                        bits &= ~(std::uint64_t{ 1 } << bit);
+                        const std::size_t idx = w * 64 + bit;
+                        if (!fn(self.priceAt(idx), self.levels_[idx])) return;
+                    }
+                }
+            }
+        }
+
+        for (; treeIt != treeEnd; ++treeIt) {
+            if (!fn(treeIt->first, treeIt->second)) return;
+        }
+    }
+};
+
+// Same interface as PriceLadder with every level in the ordered tree and no band at all:
+// the plain std::map book, for policies that want it without PriceLadder's band checks.
+// Cumulative-volume queries walk the tree level by level.
+template <typename Key, typename Level, bool Descending>
+class MapLadder {
+public:
+    using Compare = std::conditional_t<Descending, std::greater<Key>, std::less<Key>>;
+    using Tree = std::map<Key, Level, Compare>;
+    using Entry = typename PriceLadder<Key, Level, Descending>::Entry;
+
+    MapLadder() = default;
+
+    // The band arguments are accepted so either ladder builds from the same config, and ignored.
+    MapLadder(Key, std::size_t) {}
+
+    bool empty() const { return tree_.empty(); }
+    std::size_t size() const { return tree_.size(); }
+
+    Key getBase() const { return 0; }
+    std::size_t getTicks() const { return 0; }
+
+    Level* find(Key price) {
+        const auto it = tree_.find(price);
+        return it == tree_.end() ? nullptr : &it->second;
+    }
+
+    const Level* find(Key price) const { return const_cast<MapLadder*>(this)->find(price); }
+
+    Level& getOrCreate(Key price) { return tree_[price]; }
+
+    void erase(Key price) { tree_.erase(price); }
+
+    void clear() { tree_.clear(); }
+
+    Entry best() {
+        if (tree_.empty()) return Entry{ Key{}, nullptr };
+        return Entry{ tree_.begin()->first, &tree_.begin()->second };
+    }
+
+    std::optional<Key> bestPrice() const {
+        if (tree_.empty()) return std::nullopt;
+        return tree_.begin()->first;
+    }
+
+    // Level volumes are read straight from the tree, so there is no index to keep up to date.
+    void addVolume(Key, std::uint64_t) {}
+    void removeVolume(Key, std::uint64_t) {}
+
+    std::uint64_t volumeUpTo(Key price) const {
+        std::uint64_t volume = 0;
+        for (auto it = tree_.begin(); it != tree_.end() && !Compare{}(price, it->first); ++it) volume += it->second.getTotalVolume();
+        return volume;
+    }
+
+    std::optional<Key> priceForVolume(std::uint64_t volume) const {
+        std::uint64_t seen = 0;
+        for (const auto& [price, level] : tree_) {
+            seen += level.getTotalVolume();
+            if (seen >= std::max<std::uint64_t>(volume, 1)) return price;
+        }
+        return std::nullopt;
+    }
+
+    template <typename Fn>
+    void forEach(Fn&& fn) {
+        for (auto& [price, level] : tree_) {
+            if (!fn(price, level)) return;
+        }
+    }
+
+    template <typename Fn>
+    void forEach(Fn&& fn) const {
+        for (const auto& [price, level] : tree_) {
+            if (!fn(price, level)) return;
+        }
+    }
+
+    void rebase(Key) {}
+
+private:
+    Tree tree_;
+};
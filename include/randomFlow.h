@@ -0,0 +1,215 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <vector>
+
+#include "orderBook.h"
+
+// Order sizes: flat over [qtyMin, qtyMax], or log-uniform for many small orders and a long tail.
+enum class SizeDistribution { UNIFORM, LOG_UNIFORM };
+
+inline const char* sizeDistributionName(SizeDistribution distribution) {
+    return distribution == SizeDistribution::UNIFORM ? "uniform" : "log-uniform";
+}
+
+// The shape of a random add/cancel/modify flow around a fixed centre price. The benchmark's
+// workload profiles and the backtest's scenarios both extend it; RandomFlow draws from it.
+struct FlowProfile {
+    // Action mix (percent)
+    int addPct = 70;
+    int cancelPct = 15;
+    int modifyPct = 15;
+    // Share of adds that take liquidity: market IOC orders, and limit IOC/FOK orders priced
+    // through the touch. The rest are passive GTC limits.
+    int marketPct = 5;
+    int iocPct = 0;
+    int fokPct = 0;
+    // Passive prices are drawn from [centre - spread - band, centre - spread] for bids (mirrored
+    // for asks); repriced modifies land anywhere within centre +/- modifyRange.
+    Price centerPrice = 10000;
+    Price spreadHalf = 50;
+    Price bandWidth = 100;
+    Price modifyRange = 300;
+    SizeDistribution sizeDistribution = SizeDistribution::UNIFORM;
+    Quantity qtyMin = 1;
+    Quantity qtyMax = 100;
+    // Market orders are this many times a regular draw, for sweeps through several levels.
+    Quantity marketQtyScale = 1;
+    // Same for IOC/FOK limits, so fill-or-kill checks have to look past the touch.
+    Quantity immediateQtyScale = 1;
+    // Passive orders added before the flow proper, and the most resting orders the flow tracks
+    // (past that it cancels instead of acting).
+    std::uint64_t prefillOrders = 0;
+    std::size_t maxTrackedOrders = 200'000;
+    // Share of modifies that only shrink the quantity at the resting price.
+    int amendPct = 0;
+    // Share of modifies sent, as amends racing fills are, for an order that has already filled.
+    int staleModifyPct = 0;
+};
+
+// A resting order the flow tracks, for cancels and modifies to aim at.
+struct ActiveOrder {
+    OrderId id;
+    Side side;
+    Price price;
+};
+
+enum class FlowAction { ADD, CANCEL, MODIFY };
+
+// A modify RandomFlow drew: of the tracked order at index, or (stale) of an id that has filled.
+struct FlowModify {
+    OrderModify modify;
+    std::size_t index;
+    bool stale;
+};
+
+// Draws a FlowProfile's commands from one seed. The caller applies each to its book however it
+// likes (timed, journaled, as cancel + add) and reports the outcome back, which is how the
+// flow knows which orders still rest. Given the same answers, a seed always gives the same flow.
+class RandomFlow {
+public:
+    RandomFlow(const FlowProfile& profile, std::uint64_t seed)
+        : profile_(profile)
+        , rng_(seed)
+        , priceDistBuy_(profile.centerPrice - profile.spreadHalf - profile.bandWidth, profile.centerPrice - profile.spreadHalf)
+        , priceDistSell_(profile.centerPrice + profile.spreadHalf, profile.centerPrice + profile.spreadHalf + profile.bandWidth)
+        , priceDistAny_(profile.centerPrice - profile.modifyRange, profile.centerPrice + profile.modifyRange)
+        , quantityDist_(profile.qtyMin, profile.qtyMax)
+        , logQuantityDist_(std::log(static_cast<double>(profile.qtyMin)), std::log(static_cast<double>(profile.qtyMax) + 1.0))
+    {
+        active_.reserve(profile.maxTrackedOrders + 1);
+        if (profile.staleModifyPct > 0) filledIds_.reserve(kFilledIdsKept);
+    }
+
+    // Prefill order i: a passive GTC limit, sides alternating.
+    Order nextPrefill(std::uint64_t i) {
+        const Side side = (i & 1) ? Side::SELL : Side::BUY;
+        return Order(nextOrderId_++, side, OrderType::LIMIT, side == Side::BUY ? priceDistBuy_(rng_) : priceDistSell_(rng_),
+            drawQuantity(), TimeInForce::GTC);
+    }
+
+    bool wantsPrefill(std::uint64_t i) const { return i < profile_.prefillOrders && active_.size() < profile_.maxTrackedOrders; }
+
+    // Always CANCEL while more than maxTrackedOrders rest, so tracking stays bounded.
+    FlowAction nextAction() {
+        if (active_.size() > profile_.maxTrackedOrders) return FlowAction::CANCEL;
+        const int action = actionDist_(rng_);
+        if (action < profile_.addPct) return FlowAction::ADD;
+        if (action < profile_.addPct + profile_.cancelPct) return FlowAction::CANCEL;
+        return FlowAction::MODIFY;
+    }
+
+    Order nextAdd() {
+        const int takerPct = profile_.marketPct + profile_.iocPct + profile_.fokPct;
+        const Side side = (sideDist_(rng_) == 0) ? Side::BUY : Side::SELL;
+        const int kind = takerPct > 0 ? pctDist_(rng_) : 100;
+        const bool isMarket = kind < profile_.marketPct;
+        const bool isImmediate = !isMarket && kind < takerPct;
+
+        OrderType type = OrderType::LIMIT;
+        TimeInForce tif = TimeInForce::GTC;
+        Price price = 0;
+        if (isMarket) {
+            type = OrderType::MARKET;
+            tif = TimeInForce::IOC;
+        } else if (isImmediate) {
+            // Priced somewhere inside the opposite side's passive band, so it usually crosses.
+            tif = kind < profile_.marketPct + profile_.iocPct ? TimeInForce::IOC : TimeInForce::FOK;
+            price = (side == Side::BUY) ? priceDistSell_(rng_) : priceDistBuy_(rng_);
+        } else {
+            price = (side == Side::BUY) ? priceDistBuy_(rng_) : priceDistSell_(rng_);
+        }
+
+        Quantity qty = drawQuantity();
+        if (isMarket) qty *= profile_.marketQtyScale;
+        if (isImmediate) qty *= profile_.immediateQtyScale;
+        return Order(nextOrderId_++, side, type, price, qty, tif);
+    }
+
+    // Index of the tracked order to cancel; none while nothing is tracked.
+    std::optional<std::size_t> nextCancel() {
+        if (active_.empty()) return std::nullopt;
+        return pickTracked();
+    }
+
+    std::optional<FlowModify> nextModify() {
+        if (profile_.staleModifyPct > 0 && !filledIds_.empty() && pctDist_(rng_) < profile_.staleModifyPct) {
+            const OrderId id = filledIds_[std::uniform_int_distribution<std::size_t>(0, filledIds_.size() - 1)(rng_)];
+            return FlowModify{ OrderModify{ id, priceDistAny_(rng_), drawQuantity() }, 0, true };
+        }
+        if (active_.empty()) return std::nullopt;
+
+        const std::size_t index = pickTracked();
+        const ActiveOrder& active = active_[index];
+        const bool amend = profile_.amendPct > 0 && pctDist_(rng_) < profile_.amendPct;
+        const Quantity quantity = amend ? amendQuantityDist_(rng_) : drawQuantity();
+        const Price price = amend ? active.price : priceDistAny_(rng_);
+        return FlowModify{ OrderModify{ active.id, price, quantity }, index, false };
+    }
+
+    // Outcomes, with the order as the book left it.
+    void onAdded(const Order& order, const OrderResult& result) {
+        if (result.resting) active_.push_back(ActiveOrder{ order.id, order.side, order.price });
+        else if (order.isFilled()) rememberFilled(order.id);
+    }
+
+    void onCancelled(std::size_t index) { untrack(index); }
+
+    // An order that no longer rests after the modify is taken to have filled.
+    void onModified(const FlowModify& step, bool resting) {
+        if (step.stale) return;
+        if (resting) {
+            active_[step.index].price = step.modify.price_;
+        } else {
+            rememberFilled(active_[step.index].id);
+            untrack(step.index);
+        }
+    }
+
+    const ActiveOrder& getTracked(std::size_t index) const { return active_[index]; }
+    std::size_t getTrackedCount() const { return active_.size(); }
+
+private:
+    // Recent ids of orders known to have filled completely, for stale modifies to aim at.
+    static constexpr std::size_t kFilledIdsKept = 4096;
+
+    FlowProfile profile_;
+    std::mt19937_64 rng_;
+    std::uniform_int_distribution<Price> priceDistBuy_;
+    std::uniform_int_distribution<Price> priceDistSell_;
+    std::uniform_int_distribution<Price> priceDistAny_;
+    std::uniform_int_distribution<Quantity> quantityDist_;
+    std::uniform_real_distribution<double> logQuantityDist_;
+    std::uniform_int_distribution<Quantity> amendQuantityDist_{ 1, 20 };
+    std::uniform_int_distribution<int> sideDist_{ 0, 1 };
+    std::uniform_int_distribution<int> actionDist_{ 0, 99 };
+    std::uniform_int_distribution<int> pctDist_{ 0, 99 };
+
+    std::vector<ActiveOrder> active_;
+    std::vector<OrderId> filledIds_;
+    std::size_t filledCursor_ = 0;
+    OrderId nextOrderId_ = 1;
+
+    Quantity drawQuantity() {
+        if (profile_.sizeDistribution == SizeDistribution::UNIFORM) return quantityDist_(rng_);
+        const auto qty = static_cast<Quantity>(std::exp(logQuantityDist_(rng_)));
+        return std::clamp(qty, profile_.qtyMin, profile_.qtyMax);
+    }
+
+    std::size_t pickTracked() { return std::uniform_int_distribution<std::size_t>(0, active_.size() - 1)(rng_); }
+
+    void untrack(std::size_t index) {
+        active_[index] = active_.back();
+        active_.pop_back();
+    }
+
+    void rememberFilled(OrderId id) {
+        if (profile_.staleModifyPct == 0) return;
+        if (filledIds_.size() < kFilledIdsKept) filledIds_.push_back(id);
+        else filledIds_[filledCursor_++ % kFilledIdsKept] = id;
+    }
+};
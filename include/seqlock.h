@@ -0,0 +1,75 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
+#include "spscRing.h"
+
+// Single-writer sequence lock around a trivially copyable value.
+// The writer never waits: it makes the sequence odd, stores the value and makes it even again.
+// A reader copies the value and keeps the copy only if the sequence was even and unchanged
+// across it. tryRead makes exactly one attempt, so a reader polling with it is wait-free;
+// read() retries until it gets a clean copy. The value is held as relaxed atomic words so the
+// racing copy is well defined, and the lock starts on its own cache line. Until the first
+// store every read returns all-zero bytes.
+template <typename T>
+class alignas(kCacheLineSize) Seqlock {
+    static_assert(std::is_trivially_copyable_v<T> && std::is_default_constructible_v<T>);
+
+public:
+    Seqlock() = default;
+
+    Seqlock(const Seqlock&) = delete;
+    Seqlock& operator=(const Seqlock&) = delete;
+
+    // Writer side; one thread only.
+    void store(const T& value) {
+        std::array<std::uint64_t, kWords> words{};
+        std::memcpy(words.data(), &value, sizeof(T));
+
+        const std::uint64_t sequence = sequence_.load(std::memory_order_relaxed);
+        sequence_.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (std::size_t i = 0; i < kWords; ++i) words_[i].store(words[i], std::memory_order_relaxed);
+        sequence_.store(sequence + 2, std::memory_order_release);
+    }
+
+    bool tryRead(T& out) const {
+        const std::uint64_t before = sequence_.load(std::memory_order_acquire);
+        if (before & 1) return false;
+
+        std::array<std::uint64_t, kWords> words;
+        for (std::size_t i = 0; i < kWords; ++i) words[i] = words_[i].load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence_.load(std::memory_order_relaxed) != before) return false;
+
+        std::memcpy(&out, words.data(), sizeof(T));
+        return true;
+    }
+
+    T read() const {
+        T value;
+        while (!tryRead(value)) {
+#if defined(__x86_64__) || defined(_M_X64)
+            _mm_pause();
+#endif
+        }
+        return value;
+    }
+
+    // Stores completed so far.
+    std::uint64_t version() const { return sequence_.load(std::memory_order_acquire) / 2; }
+
+private:
+    static constexpr std::size_t kWords = (sizeof(T) + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t);
+
+    std::atomic<std::uint64_t> sequence_{ 0 };
+    std::array<std::atomic<std::uint64_t>, kWords> words_{};
+};
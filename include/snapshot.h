@@ -0,0 +1,284 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "orderBook.h"
+
+// Versioned binary image of a book's resting state, for restarts without a full replay.
+//
+// Layout (native endianness): a 128-byte SnapshotHeader, then every bid level followed by
+// every ask level in priority order, then the resting orders level by level in queue order.
+// Only GTC limit orders ever rest, so an order record is just its id and quantities; side
+// and price come from the level it belongs to. Pending stops follow the same way: buy then
+// sell trigger levels in firing order, then their orders, keyed by stop price.
+struct SnapshotHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t levelRecordSize;
+    std::uint32_t orderRecordSize;
+    std::uint32_t stopRecordSize;
+    std::uint64_t bidLevels;
+    std::uint64_t askLevels;
+    std::uint64_t orderCount;
+    // Dense band bases at save time, so a restored ladder keeps the same levels in its band.
+    std::int64_t bidBase;
+    std::int64_t askBase;
+    std::uint64_t buyStopLevels;
+    std::uint64_t sellStopLevels;
+    std::uint64_t stopCount;
+    // Stops trigger off the last trade, so it travels with them.
+    std::uint64_t hasLastTrade;
+    std::int64_t lastTradePrice;
+    std::int64_t buyStopBase;
+    std::int64_t sellStopBase;
+    std::uint64_t reserved;
+};
+
+struct SnapshotLevel {
+    std::int64_t price;
+    std::uint64_t orderCount;
+};
+
+struct SnapshotOrder {
+    std::uint64_t id;
+    std::uint64_t quantity;
+    std::uint64_t filledQuantity;
+};
+
+// A pending stop has filled nothing; side and stop price come from its trigger level.
+struct SnapshotStop {
+    std::uint64_t id;
+    std::uint64_t quantity;
+    std::int64_t price;
+    std::uint8_t type;
+    std::uint8_t tif;
+    std::uint8_t reserved[6];
+};
+
+static_assert(sizeof(SnapshotHeader) == 128 && std::is_trivially_copyable_v<SnapshotHeader>);
+static_assert(sizeof(SnapshotLevel) == 16 && std::is_trivially_copyable_v<SnapshotLevel>);
+static_assert(sizeof(SnapshotOrder) == 24 && std::is_trivially_copyable_v<SnapshotOrder>);
+static_assert(sizeof(SnapshotStop) == 32 && std::is_trivially_copyable_v<SnapshotStop>);
+
+inline constexpr char kSnapshotMagic[8] = { 'O', 'B', 'S', 'N', 'A', 'P', '\0', '\0' };
+inline constexpr std::uint32_t kSnapshotVersion = 2;
+
+class BookSnapshot {
+public:
+    template <typename Policy>
+    static std::vector<std::byte> save(const BasicOrderBook<Policy>& book) {
+        SnapshotHeader header{};
+        std::memcpy(header.magic, kSnapshotMagic, sizeof(header.magic));
+        header.version = kSnapshotVersion;
+        header.levelRecordSize = sizeof(SnapshotLevel);
+        header.orderRecordSize = sizeof(SnapshotOrder);
+        header.stopRecordSize = sizeof(SnapshotStop);
+        header.bidLevels = book.bids_.size();
+        header.askLevels = book.asks_.size();
+        header.orderCount = book.getOrderCount();
+        header.bidBase = book.bids_.getBase();
+        header.askBase = book.asks_.getBase();
+        header.buyStopLevels = book.buyStops_.size();
+        header.sellStopLevels = book.sellStops_.size();
+        header.stopCount = book.getPendingStopCount();
+        header.hasLastTrade = book.lastTradePrice_ ? 1 : 0;
+        header.lastTradePrice = book.lastTradePrice_.value_or(0);
+        header.buyStopBase = book.buyStops_.getBase();
+        header.sellStopBase = book.sellStops_.getBase();
+
+        const std::size_t levelCount = static_cast<std::size_t>(header.bidLevels + header.askLevels);
+        const std::size_t stopLevelCount = static_cast<std::size_t>(header.buyStopLevels + header.sellStopLevels);
+        std::vector<std::byte> bytes(sizeof(SnapshotHeader) + levelCount * sizeof(SnapshotLevel)
+            + static_cast<std::size_t>(header.orderCount) * sizeof(SnapshotOrder)
+            + stopLevelCount * sizeof(SnapshotLevel) + static_cast<std::size_t>(header.stopCount) * sizeof(SnapshotStop));
+        std::memcpy(bytes.data(), &header, sizeof(header));
+
+        std::byte* levelOut = bytes.data() + sizeof(SnapshotHeader);
+        std::byte* orderOut = levelOut + levelCount * sizeof(SnapshotLevel);
+        auto saveSide = [&](const auto& ladder, auto&& saveOrder) {
+            ladder.forEach([&](Price price, const auto& level) {
+                SnapshotLevel record{ price, 0 };
+                level.forEachOrder(book.orders_, [&](OrderHandle h) {
+                    saveOrder(book.orders_[h]);
+                    ++record.orderCount;
+                });
+                std::memcpy(levelOut, &record, sizeof(record));
+                levelOut += sizeof(record);
+                return true;
+            });
+        };
+        auto saveResting = [&](const Order& order) {
+            const SnapshotOrder saved{ order.id, order.quantity, order.getFilledQuantity() };
+            std::memcpy(orderOut, &saved, sizeof(saved));
+            orderOut += sizeof(saved);
+        };
+        saveSide(book.bids_, saveResting);
+        saveSide(book.asks_, saveResting);
+
+        levelOut = orderOut;
+        orderOut += stopLevelCount * sizeof(SnapshotLevel);
+        auto saveStop = [&](const Order& order) {
+            const SnapshotStop saved{ order.id, order.getRemainingQuantity(), order.price,
+                static_cast<std::uint8_t>(order.type), static_cast<std::uint8_t>(order.tif), {} };
+            std::memcpy(orderOut, &saved, sizeof(saved));
+            orderOut += sizeof(saved);
+        };
+        saveSide(book.buyStops_, saveStop);
+        saveSide(book.sellStops_, saveStop);
+        return bytes;
+    }
+
+    // Rebuilds levels, queues, pending stops and the id index straight from the image, without
+    // matching or level updates. The book must be empty; if the image is rejected part-way
+    // (duplicate ids) the book is left half-loaded and should be discarded.
+    template <typename Policy>
+    static void load(BasicOrderBook<Policy>& book, std::span<const std::byte> bytes) {
+        if (!book.isEmpty()) throw std::logic_error("snapshot can only be loaded into an empty book");
+
+        if (bytes.size() < sizeof(SnapshotHeader)) throw std::runtime_error("snapshot is truncated");
+        SnapshotHeader header;
+        std::memcpy(&header, bytes.data(), sizeof(header));
+        if (std::memcmp(header.magic, kSnapshotMagic, sizeof(header.magic)) != 0
+            || header.version != kSnapshotVersion
+            || header.levelRecordSize != sizeof(SnapshotLevel)
+            || header.orderRecordSize != sizeof(SnapshotOrder)
+            || header.stopRecordSize != sizeof(SnapshotStop)) {
+            throw std::runtime_error("not a version " + std::to_string(kSnapshotVersion) + " book snapshot");
+        }
+
+        const std::uint64_t limit = bytes.size();
+        if (header.bidLevels > limit || header.askLevels > limit || header.orderCount > limit
+            || header.buyStopLevels > limit || header.sellStopLevels > limit || header.stopCount > limit) {
+            throw std::runtime_error("snapshot size does not match its header");
+        }
+        const std::uint64_t levelCount = header.bidLevels + header.askLevels;
+        const std::uint64_t stopLevelCount = header.buyStopLevels + header.sellStopLevels;
+        const std::uint64_t expected = sizeof(SnapshotHeader) + levelCount * sizeof(SnapshotLevel)
+            + header.orderCount * sizeof(SnapshotOrder) + stopLevelCount * sizeof(SnapshotLevel)
+            + header.stopCount * sizeof(SnapshotStop);
+        if (bytes.size() != expected) throw std::runtime_error("snapshot size does not match its header");
+        if (header.stopCount > 0 && !Policy::kStopOrders) throw std::runtime_error("snapshot holds stop orders this book does not take");
+
+        const std::byte* levelIn = bytes.data() + sizeof(SnapshotHeader);
+        const std::byte* orderIn = levelIn + levelCount * sizeof(SnapshotLevel);
+        const std::byte* orderEnd = orderIn + header.orderCount * sizeof(SnapshotOrder);
+        const std::byte* stopLevelIn = orderEnd;
+        const std::byte* stopIn = stopLevelIn + stopLevelCount * sizeof(SnapshotLevel);
+        const std::byte* stopEnd = bytes.data() + bytes.size();
+
+        const std::size_t idCount = static_cast<std::size_t>(header.orderCount + header.stopCount);
+        book.orders_.reserve(idCount);
+        book.orderLookup_.reserve(idCount);
+
+        // Ids come out in queue order, not id order; move a dense window up front so it ends
+        // where the live book's was instead of spilling every out-of-order id to its overflow.
+        std::uint64_t maxId = 0;
+        for (const std::byte* in = orderIn; in != orderEnd; in += sizeof(SnapshotOrder)) {
+            SnapshotOrder saved;
+            std::memcpy(&saved, in, sizeof(saved));
+            maxId = std::max(maxId, saved.id);
+        }
+        for (const std::byte* in = stopIn; in != stopEnd; in += sizeof(SnapshotStop)) {
+            SnapshotStop saved;
+            std::memcpy(&saved, in, sizeof(saved));
+            maxId = std::max(maxId, saved.id);
+        }
+        if constexpr (requires { book.orderLookup_.advanceTo(maxId); }) book.orderLookup_.advanceTo(maxId);
+
+        // Reads one side's level table, handing each level's records to loadOrder in queue order.
+        auto loadSide = [&](auto& ladder, const std::byte*& in, const std::byte*& records, const std::byte* end,
+                            std::size_t recordSize, std::uint64_t levels, bool descending, auto&& loadOrder) {
+            std::optional<Price> previous;
+            for (std::uint64_t i = 0; i < levels; ++i) {
+                SnapshotLevel record;
+                std::memcpy(&record, in, sizeof(record));
+                in += sizeof(record);
+
+                const bool ordered = !previous || (descending ? record.price < *previous : record.price > *previous);
+                const std::uint64_t available = static_cast<std::uint64_t>(end - records) / recordSize;
+                if (!ordered || record.orderCount == 0 || record.orderCount > available) {
+                    throw std::runtime_error("snapshot level table is corrupt");
+                }
+                previous = record.price;
+
+                auto& level = ladder.getOrCreate(record.price);
+                for (std::uint64_t n = 0; n < record.orderCount; ++n) {
+                    const OrderHandle handle = loadOrder(records, record.price);
+                    records += recordSize;
+                    level.addOrder(book.orders_, handle);
+                    if (!book.orderLookup_.insert(book.orders_[handle].id, OrderEntry{ handle })) {
+                        throw std::runtime_error("snapshot repeats an order id");
+                    }
+                }
+                ladder.addVolume(record.price, level.getTotalVolume());
+            }
+        };
+
+        auto loadResting = [&](Side side) {
+            return [&book, side](const std::byte* in, Price price) {
+                SnapshotOrder saved;
+                std::memcpy(&saved, in, sizeof(saved));
+                if (saved.quantity == 0) throw std::runtime_error("snapshot holds an order for nothing");
+                if (saved.filledQuantity >= saved.quantity) throw std::runtime_error("snapshot holds a filled order");
+
+                Order order(saved.id, side, OrderType::LIMIT, price, saved.quantity, TimeInForce::GTC);
+                order.remainingQuantity = saved.quantity - saved.filledQuantity;
+                return book.orders_.acquire(order);
+            };
+        };
+        loadSide(book.bids_, levelIn, orderIn, orderEnd, sizeof(SnapshotOrder), header.bidLevels, true, loadResting(Side::BUY));
+        loadSide(book.asks_, levelIn, orderIn, orderEnd, sizeof(SnapshotOrder), header.askLevels, false, loadResting(Side::SELL));
+        if (orderIn != orderEnd) throw std::runtime_error("snapshot level table is corrupt");
+
+        auto loadStop = [&](Side side) {
+            return [&book, side](const std::byte* in, Price stopPrice) {
+                SnapshotStop saved;
+                std::memcpy(&saved, in, sizeof(saved));
+                const OrderType type = static_cast<OrderType>(saved.type);
+                if ((type != OrderType::STOP && type != OrderType::STOP_LIMIT) || saved.tif > static_cast<std::uint8_t>(TimeInForce::FOK)
+                    || saved.quantity == 0) {
+                    throw std::runtime_error("snapshot holds a corrupt stop order");
+                }
+                return book.orders_.acquire(Order(saved.id, side, type, saved.price, saved.quantity, static_cast<TimeInForce>(saved.tif), stopPrice));
+            };
+        };
+        loadSide(book.buyStops_, stopLevelIn, stopIn, stopEnd, sizeof(SnapshotStop), header.buyStopLevels, false, loadStop(Side::BUY));
+        loadSide(book.sellStops_, stopLevelIn, stopIn, stopEnd, sizeof(SnapshotStop), header.sellStopLevels, true, loadStop(Side::SELL));
+        if (stopIn != stopEnd) throw std::runtime_error("snapshot level table is corrupt");
+        book.pendingStops_ = static_cast<std::size_t>(header.stopCount);
+        if (header.hasLastTrade) book.lastTradePrice_ = header.lastTradePrice;
+
+        // getOrCreate may have moved an empty band to the first level it saw; put it back.
+        if (book.bids_.getTicks() > 0) book.bids_.rebase(header.bidBase);
+        if (book.asks_.getTicks() > 0) book.asks_.rebase(header.askBase);
+        if (book.buyStops_.getTicks() > 0) book.buyStops_.rebase(header.buyStopBase);
+        if (book.sellStops_.getTicks() > 0) book.sellStops_.rebase(header.sellStopBase);
+    }
+};
+
+inline void writeSnapshotFile(const std::string& path, std::span<const std::byte> bytes) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    out.close();
+    if (!out) throw std::runtime_error("cannot write snapshot '" + path + "'");
+}
+
+inline std::vector<std::byte> readSnapshotFile(const std::string& path) {
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) throw std::runtime_error("cannot open snapshot '" + path + "'");
+
+    std::vector<std::byte> bytes(static_cast<std::size_t>(in.tellg()));
+    in.seekg(0);
+    in.read(reinterpret_cast<char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    if (!in) throw std::runtime_error("cannot read snapshot '" + path + "'");
+    return bytes;
+}
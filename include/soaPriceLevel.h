@@ -0,0 +1,136 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "levelKernels.h"
+#include "orderBook.h"
+
+// Level queue kept as parallel arrays, oldest first: each slot's remaining quantity and pool
+// handle. Totalling a level or finding how far an incoming quantity reaches into it reads
+// 8 bytes per order (with AVX2 where the CPU has it) instead of following links through
+// 56-byte pool nodes. A slot's quantity mirrors its order's remaining quantity; cancelled and
+// filled slots are zeroed and compacted away once they outnumber the live ones. Each queued
+// order's slot index lives in its pool node's prev link, which this queue has no other use for.
+//
+// Select it with a policy: struct SoaLevelPolicy : DefaultBookPolicy { using LevelQueue = SoaPriceLevel; };
+class SoaPriceLevel {
+public:
+    template <typename Pool>
+    void addOrder(Pool& pool, OrderHandle handle) {
+        const Quantity quantity = pool[handle].getRemainingQuantity();
+        pool.prev(handle) = static_cast<OrderHandle>(remaining_.size());
+        remaining_.push_back(quantity);
+        handles_.push_back(handle);
+        totalVolume_ += quantity;
+        ++live_;
+    }
+
+    template <typename Pool>
+    void removeOrder(Pool& pool, OrderHandle handle) {
+        const std::size_t slot = pool.prev(handle);
+        totalVolume_ -= remaining_[slot];
+        remaining_[slot] = 0;
+        --live_;
+        dropDeadSlots(pool);
+    }
+
+    template <typename Pool>
+    void reduceOrder(Pool& pool, OrderHandle handle, Quantity released) {
+        remaining_[pool.prev(handle)] -= released;
+        totalVolume_ -= released;
+    }
+
+    // Same contract as PriceLevel::match. The cut is found on the quantity array first, so only
+    // the orders actually filled into are loaded.
+    template <typename Pool, typename OnFill>
+    Quantity match(Pool& pool, Quantity wanted, OnFill&& onFill) {
+        const std::size_t count = remaining_.size() - head_;
+        const FillCut cut = findFillCut(remaining_.data() + head_, count, wanted);
+        const std::size_t end = head_ + std::min(cut.index + 1, count);
+
+        Quantity filled = 0;
+        for (std::size_t slot = head_; slot < end; ++slot) {
+            const Quantity available = remaining_[slot];
+            if (available == 0) continue;
+
+            const Quantity quantity = std::min(available, wanted - filled);
+            remaining_[slot] = available - quantity;
+            filled += quantity;
+
+            const OrderHandle handle = handles_[slot];
+            auto& order = pool[handle];
+            order.fill(quantity);
+            if (order.isFilled()) --live_;
+            onFill(handle, order, quantity);
+        }
+        totalVolume_ -= filled;
+        dropDeadSlots(pool);
+        return filled;
+    }
+
+    template <typename Pool, typename Fn>
+    void forEachOrder(const Pool&, Fn&& fn) const {
+        for (std::size_t slot = head_; slot < remaining_.size(); ++slot) {
+            if (remaining_[slot] != 0) fn(handles_[slot]);
+        }
+    }
+
+    template <typename Pool>
+    Quantity recomputeTotalVolume(const Pool&) {
+        totalVolume_ = sumQuantities(remaining_.data() + head_, remaining_.size() - head_);
+        return totalVolume_;
+    }
+
+    Quantity getTotalVolume() const { return totalVolume_; }
+    bool isEmpty() const { return live_ == 0; }
+
+    // Empties the queue but keeps its arrays for the next orders at this price.
+    void clear() {
+        remaining_.clear();
+        handles_.clear();
+        head_ = 0;
+        live_ = 0;
+        totalVolume_ = 0;
+    }
+
+    // Heap bytes held for the queue arrays.
+    std::size_t getStorageBytes() const {
+        return remaining_.capacity() * sizeof(Quantity) + handles_.capacity() * sizeof(OrderHandle);
+    }
+
+private:
+    static constexpr std::size_t kCompactAfter = 32;
+
+    std::vector<Quantity> remaining_;
+    std::vector<OrderHandle> handles_;
+    std::size_t head_ = 0; // slots before it are all used up
+    std::uint32_t live_ = 0;
+    Quantity totalVolume_ = 0;
+
+    // Moves the head past used-up slots and compacts once dead slots dominate.
+    template <typename Pool>
+    void dropDeadSlots(Pool& pool) {
+        if (live_ == 0) {
+            clear();
+            return;
+        }
+        while (remaining_[head_] == 0) ++head_;
+
+        const std::size_t dead = remaining_.size() - live_;
+        if (dead < kCompactAfter || dead <= live_) return;
+
+        std::size_t out = 0;
+        for (std::size_t slot = head_; slot < remaining_.size(); ++slot) {
+            if (remaining_[slot] == 0) continue;
+            remaining_[out] = remaining_[slot];
+            handles_[out] = handles_[slot];
+            pool.prev(handles_[out]) = static_cast<OrderHandle>(out);
+            ++out;
+        }
+        remaining_.resize(out);
+        handles_.resize(out);
+        head_ = 0;
+    }
+};
@@ -0,0 +1,92 @@
+#pragma once
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+
+inline constexpr std::size_t kCacheLineSize = 64;
+
+// Bounded single-producer/single-consumer ring of trivially copyable records.
+// Producer and consumer indices sit on their own cache lines, and each side keeps a cached
+// copy of the other's index so the shared line is only re-read when the ring looks full/empty.
+template <typename T>
+class SpscRing {
+    static_assert(std::is_trivially_copyable_v<T>);
+
+public:
+    explicit SpscRing(std::size_t capacity)
+        : capacity_(std::bit_ceil(capacity < 2 ? std::size_t{ 2 } : capacity))
+        , mask_(capacity_ - 1)
+        , slots_(std::make_unique<T[]>(capacity_))
+    {
+    }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    std::size_t capacity() const { return capacity_; }
+
+    // Producer side.
+    bool tryPush(const T& value) {
+        const std::size_t tail = producer_.tail.load(std::memory_order_relaxed);
+        if (tail - producer_.cachedHead == capacity_) {
+            producer_.cachedHead = consumer_.head.load(std::memory_order_acquire);
+            if (tail - producer_.cachedHead == capacity_) return false;
+        }
+        slots_[tail & mask_] = value;
+        producer_.tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side.
+    bool tryPop(T& value) {
+        const std::size_t head = consumer_.head.load(std::memory_order_relaxed);
+        if (head == consumer_.cachedTail) {
+            consumer_.cachedTail = producer_.tail.load(std::memory_order_acquire);
+            if (head == consumer_.cachedTail) return false;
+        }
+        value = slots_[head & mask_];
+        consumer_.head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side: hands up to maxCount records to fn(const T&) and frees their slots in one store.
+    template <typename Fn>
+    std::size_t consumeBatch(std::size_t maxCount, Fn&& fn) {
+        const std::size_t head = consumer_.head.load(std::memory_order_relaxed);
+        if (head == consumer_.cachedTail) {
+            consumer_.cachedTail = producer_.tail.load(std::memory_order_acquire);
+            if (head == consumer_.cachedTail) return 0;
+        }
+
+        const std::size_t available = consumer_.cachedTail - head;
+        const std::size_t count = available < maxCount ? available : maxCount;
+        for (std::size_t i = 0; i < count; ++i) {
+            fn(slots_[(head + i) & mask_]);
+        }
+        consumer_.head.store(head + count, std::memory_order_release);
+        return count;
+    }
+
+    bool empty() const {
+        return consumer_.head.load(std::memory_order_acquire) == producer_.tail.load(std::memory_order_acquire);
+    }
+
+private:
+    struct alignas(kCacheLineSize) ProducerState {
+        std::atomic<std::size_t> tail{ 0 };
+        std::size_t cachedHead = 0;
+    };
+
+    struct alignas(kCacheLineSize) ConsumerState {
+        std::atomic<std::size_t> head{ 0 };
+        std::size_t cachedTail = 0;
+    };
+
+    const std::size_t capacity_;
+    const std::size_t mask_;
+    std::unique_ptr<T[]> slots_;
+    ProducerState producer_;
+    ConsumerState consumer_;
+};
@@ -0,0 +1,147 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+
+#include "histogram.h"
+#include "orderBook.h"
+#include "seqlock.h"
+
+struct QuoteLevel {
+    Price price;
+    Quantity volume;
+};
+
+// Fixed-size picture of the best Depth levels per side, as of one command.
+template <std::size_t Depth>
+struct BookTop {
+    // Whatever the publisher passed in, e.g. the sequence number of the last command applied.
+    std::uint64_t sequence;
+    // latency_clock ticks at publish; latency_clock::nanosPerTick() converts.
+    std::uint64_t publishedTicks;
+    std::uint32_t bidLevels;
+    std::uint32_t askLevels;
+    std::array<QuoteLevel, Depth> bids;
+    std::array<QuoteLevel, Depth> asks;
+
+    std::optional<Price> bestBid() const { return bidLevels ? std::optional<Price>(bids[0].price) : std::nullopt; }
+    std::optional<Price> bestAsk() const { return askLevels ? std::optional<Price>(asks[0].price) : std::nullopt; }
+
+    std::optional<Price> spread() const {
+        if (!bidLevels || !askLevels) return std::nullopt;
+        return asks[0].price - bids[0].price;
+    }
+};
+
+// Top-of-book and top-Depth depth for threads other than the matcher. The matching thread
+// publishes after each command that changed the book, normally from the level update handler;
+// any number of readers take consistent copies through the seqlock without locks and without
+// ever making the matcher wait.
+//
+// The publisher keeps the last picture it stored, so publishing with the command's level
+// updates only patches it: changes beyond the top Depth are skipped, volume changes and new
+// levels are applied in place, and a side is re-read from the book only when one of its
+// published levels disappears while deeper levels may exist. A command that leaves the top
+// Depth untouched stores nothing, so a snapshot's sequence is that of the last command that
+// changed what it shows.
+template <std::size_t Depth = 10>
+class TopOfBookPublisher {
+    static_assert(Depth > 0);
+
+public:
+    using Snapshot = BookTop<Depth>;
+
+    // Re-reads both sides from the book.
+    template <typename Policy>
+    void publish(const BasicOrderBook<Policy>& book, std::uint64_t sequence) {
+        current_.bidLevels = copyLevels(book, Side::BUY, current_.bids);
+        current_.askLevels = copyLevels(book, Side::SELL, current_.asks);
+        store(sequence);
+    }
+
+    // Applies one command's level updates; the book is only read if a side has to be refilled.
+    // The last store must reflect the book as it was before the command, so a publisher attached
+    // to a book that already holds orders needs one full publish first.
+    template <typename Policy>
+    void publish(const BasicOrderBook<Policy>& book, std::uint64_t sequence, std::span<const LevelUpdate> updates) {
+        bool changed = false;
+        bool refillBids = false;
+        bool refillAsks = false;
+        for (const LevelUpdate& update : updates) {
+            const bool bid = update.side == Side::BUY;
+            bool& refill = bid ? refillBids : refillAsks;
+            if (refill) continue;
+            switch (apply(bid ? current_.bids : current_.asks, bid ? current_.bidLevels : current_.askLevels, bid, update)) {
+            case Patch::NONE: break;
+            case Patch::APPLIED: changed = true; break;
+            case Patch::REFILL: refill = true; break;
+            }
+        }
+        if (refillBids) current_.bidLevels = copyLevels(book, Side::BUY, current_.bids);
+        if (refillAsks) current_.askLevels = copyLevels(book, Side::SELL, current_.asks);
+        if (changed || refillBids || refillAsks) store(sequence);
+    }
+
+    // Reader side, from any thread.
+    Snapshot read() const { return snapshot_.read(); }
+    bool tryRead(Snapshot& out) const { return snapshot_.tryRead(out); }
+    std::uint64_t version() const { return snapshot_.version(); }
+
+private:
+    Seqlock<Snapshot> snapshot_;
+    Snapshot current_{}; // matcher-side copy of the last store
+
+    void store(std::uint64_t sequence) {
+        current_.sequence = sequence;
+        current_.publishedTicks = latency_clock::now();
+        snapshot_.store(current_);
+    }
+
+    enum class Patch { NONE, APPLIED, REFILL };
+
+    // Patches one side for one level update; REFILL when only the book can say what the side
+    // now holds.
+    static Patch apply(std::array<QuoteLevel, Depth>& levels, std::uint32_t& count, bool bid, const LevelUpdate& update) {
+        auto ahead = [bid](Price lhs, Price rhs) { return bid ? lhs > rhs : lhs < rhs; };
+
+        // Where the level is, or would go, in priority order.
+        std::uint32_t at = 0;
+        while (at < count && ahead(levels[at].price, update.price)) ++at;
+        if (at == Depth) return Patch::NONE; // beyond the published depth
+        const bool present = at < count && levels[at].price == update.price;
+
+        switch (update.action) {
+        case LevelAction::CHANGE:
+            if (!present) return Patch::REFILL;
+            levels[at].volume = update.volume;
+            return Patch::APPLIED;
+        case LevelAction::ADD:
+            if (present) return Patch::REFILL;
+            std::copy_backward(levels.begin() + at, levels.begin() + std::min<std::size_t>(count, Depth - 1), levels.begin() + std::min<std::size_t>(count + 1, Depth));
+            levels[at] = QuoteLevel{ update.price, update.volume };
+            count = std::min<std::uint32_t>(count + 1, Depth);
+            return Patch::APPLIED;
+        case LevelAction::REMOVE:
+            if (!present) return Patch::REFILL;
+            // A full side may have a level waiting behind the last published one.
+            if (count == Depth) return Patch::REFILL;
+            std::copy(levels.begin() + at + 1, levels.begin() + count, levels.begin() + at);
+            --count;
+            return Patch::APPLIED;
+        }
+        return Patch::REFILL;
+    }
+
+    template <typename Policy>
+    static std::uint32_t copyLevels(const BasicOrderBook<Policy>& book, Side side, std::array<QuoteLevel, Depth>& out) {
+        std::uint32_t count = 0;
+        book.forEachLevel(side, [&](Price price, Quantity volume) {
+            out[count++] = QuoteLevel{ price, volume };
+            return count < Depth;
+        });
+        return count;
+    }
+};
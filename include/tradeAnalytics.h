@@ -0,0 +1,134 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "orderBook.h"
+
+// One fixed-interval bar, covering [start, start + interval) on the caller's clock.
+struct OhlcvBar {
+    std::int64_t start = 0;
+    Price open = 0;
+    Price high = 0;
+    Price low = 0;
+    Price close = 0;
+    Quantity volume = 0;
+    std::uint64_t trades = 0;
+    Price notional = 0; // sum of price x quantity, in ticks
+
+    double getVwap() const { return volume ? static_cast<double>(notional) / static_cast<double>(volume) : 0.0; }
+};
+
+// Running trade statistics kept by the book itself: a policy selects it with
+//   struct AnalyticsPolicy : DefaultBookPolicy { using Analytics = TradeAnalytics; };
+// and the match loop reports each level it fills into (price, quantity, number of fills).
+// Updates are O(1) per level and never allocate; everything can be read between commands.
+//
+// Totals run from construction or reset(). Bars are cut on a clock the caller owns: any
+// non-decreasing integer (nanoseconds, exchange timestamps, sequence numbers) passed to
+// setTime before the commands it applies to. A bar closes once the clock passes its end;
+// intervals without trades make no bar. Closed bars go into a ring sized by configureBars,
+// which drops the oldest when full.
+class TradeAnalytics {
+public:
+    // Bars of barInterval clock units, keeping the last barsKept closed ones. An interval of 0
+    // (the default) turns bars off. Allocates the ring, so call it up front.
+    void configureBars(std::int64_t barInterval, std::size_t barsKept) {
+        barInterval_ = std::max<std::int64_t>(barInterval, 0);
+        ring_.assign(barInterval_ > 0 ? std::max<std::size_t>(barsKept, 1) : 0, OhlcvBar{});
+        resetBars();
+    }
+
+    void setTime(std::int64_t now) {
+        now_ = now;
+        if (barOpen_ && now_ >= bar_.start + barInterval_) closeBar();
+    }
+
+    // quantity traded at price in fills separate prints.
+    void recordTrades(Price price, Quantity quantity, std::uint64_t fills) {
+        volume_ += quantity;
+        trades_ += fills;
+        notional_ += price * static_cast<Price>(quantity);
+        lastPrice_ = price;
+
+        if (barInterval_ == 0) return;
+        if (!barOpen_) openBar(price);
+        bar_.high = std::max(bar_.high, price);
+        bar_.low = std::min(bar_.low, price);
+        bar_.close = price;
+        bar_.volume += quantity;
+        bar_.trades += fills;
+        bar_.notional += price * static_cast<Price>(quantity);
+    }
+
+    Quantity getVolume() const { return volume_; }
+    std::uint64_t getTradeCount() const { return trades_; }
+    Price getNotional() const { return notional_; }
+    std::optional<Price> getLastPrice() const { return lastPrice_; }
+
+    std::optional<double> getVwap() const {
+        if (volume_ == 0) return std::nullopt;
+        return static_cast<double>(notional_) / static_cast<double>(volume_);
+    }
+
+    // The bar still taking trades, if any.
+    std::optional<OhlcvBar> getOpenBar() const {
+        if (!barOpen_) return std::nullopt;
+        return bar_;
+    }
+
+    // Closed bars still in the ring, oldest first.
+    std::size_t getBarCount() const { return barCount_; }
+    const OhlcvBar& getBar(std::size_t index) const { return ring_[(ringHead_ + index) % ring_.size()]; }
+    std::uint64_t getBarsDropped() const { return barsDropped_; }
+
+    void reset() {
+        volume_ = 0;
+        trades_ = 0;
+        notional_ = 0;
+        lastPrice_.reset();
+        resetBars();
+    }
+
+private:
+    Quantity volume_ = 0;
+    std::uint64_t trades_ = 0;
+    Price notional_ = 0;
+    std::optional<Price> lastPrice_;
+
+    std::int64_t barInterval_ = 0;
+    std::int64_t now_ = 0;
+    bool barOpen_ = false;
+    OhlcvBar bar_;
+    std::vector<OhlcvBar> ring_;
+    std::size_t ringHead_ = 0; // oldest closed bar
+    std::size_t barCount_ = 0;
+    std::uint64_t barsDropped_ = 0;
+
+    void resetBars() {
+        barOpen_ = false;
+        ringHead_ = 0;
+        barCount_ = 0;
+        barsDropped_ = 0;
+    }
+
+    void openBar(Price price) {
+        // Floor to the interval, negative clocks included.
+        const std::int64_t offset = ((now_ % barInterval_) + barInterval_) % barInterval_;
+        bar_ = OhlcvBar{ now_ - offset, price, price, price, price, 0, 0, 0 };
+        barOpen_ = true;
+    }
+
+    void closeBar() {
+        barOpen_ = false;
+        if (barCount_ == ring_.size()) {
+            ringHead_ = (ringHead_ + 1) % ring_.size();
+            --barCount_;
+            ++barsDropped_;
+        }
+        ring_[(ringHead_ + barCount_) % ring_.size()] = bar_;
+        ++barCount_;
+    }
+};
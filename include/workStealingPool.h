@@ -0,0 +1,154 @@
+#pragma once
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads for batches of independent jobs. run(count, job) deals the job
+// indices out to per-worker deques in contiguous blocks; a worker takes from the back of its
+// own deque and, once that is empty, steals from the front of the others, so a block of slow
+// jobs doesn't leave the rest of the pool idle. The deques are mutex-guarded: a job here is a
+// whole simulation, far longer than the lock.
+class WorkStealingPool {
+public:
+    // 0 threads sizes the pool to the machine.
+    explicit WorkStealingPool(std::size_t threads = 0) {
+        if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+        queues_.reserve(threads);
+        for (std::size_t i = 0; i < threads; ++i) queues_.push_back(std::make_unique<Queue>());
+        threads_.reserve(threads);
+        for (std::size_t i = 0; i < threads; ++i) threads_.emplace_back([this, i] { workerLoop(i); });
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    ~WorkStealingPool() {
+        {
+            std::lock_guard lock(mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_all();
+        for (std::thread& thread : threads_) thread.join();
+    }
+
+    std::size_t getThreadCount() const { return threads_.size(); }
+
+    // Calls job(index, worker) once for every index in [0, count) and returns when all have
+    // finished. The first exception a job throws is rethrown here once the batch has drained.
+    void run(std::size_t count, std::function<void(std::size_t, std::size_t)> job) {
+        if (count == 0) return;
+
+        // Dealt under the lock, after job_ is set: a worker still in the loop from the last
+        // batch can pick these up, and then sees this batch's job.
+        std::unique_lock lock(mutex_);
+        job_ = std::move(job);
+        remaining_ = count;
+        failure_ = nullptr;
+        const std::size_t workers = queues_.size();
+        for (std::size_t w = 0; w < workers; ++w) {
+            Queue& queue = *queues_[w];
+            std::lock_guard queueLock(queue.mutex);
+            for (std::size_t index = w * count / workers; index < (w + 1) * count / workers; ++index) queue.jobs.push_back(index);
+        }
+        ++generation_;
+        wake_.notify_all();
+        // Also wait out workers that woke for this batch but found nothing left.
+        done_.wait(lock, [this] { return remaining_ == 0 && active_ == 0; });
+        job_ = nullptr;
+        if (failure_) std::rethrow_exception(failure_);
+    }
+
+    // Jobs taken from another worker's deque, over the pool's lifetime.
+    std::uint64_t getStealCount() const {
+        std::lock_guard lock(mutex_);
+        return steals_;
+    }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::size_t> jobs;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> threads_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    std::function<void(std::size_t, std::size_t)> job_;
+    std::uint64_t generation_ = 0;
+    std::size_t remaining_ = 0;
+    std::size_t active_ = 0; // workers inside a batch
+    std::uint64_t steals_ = 0;
+    std::exception_ptr failure_;
+    bool stopping_ = false;
+
+    std::optional<std::size_t> takeOwn(std::size_t worker) {
+        Queue& queue = *queues_[worker];
+        std::lock_guard lock(queue.mutex);
+        if (queue.jobs.empty()) return std::nullopt;
+        const std::size_t index = queue.jobs.back();
+        queue.jobs.pop_back();
+        return index;
+    }
+
+    std::optional<std::size_t> steal(std::size_t worker) {
+        for (std::size_t offset = 1; offset < queues_.size(); ++offset) {
+            Queue& queue = *queues_[(worker + offset) % queues_.size()];
+            std::lock_guard lock(queue.mutex);
+            if (queue.jobs.empty()) continue;
+            const std::size_t index = queue.jobs.front();
+            queue.jobs.pop_front();
+            return index;
+        }
+        return std::nullopt;
+    }
+
+    void workerLoop(std::size_t worker) {
+        std::uint64_t seen = 0;
+        for (;;) {
+            {
+                std::unique_lock lock(mutex_);
+                wake_.wait(lock, [&] { return stopping_ || generation_ != seen; });
+                if (stopping_) return;
+                seen = generation_;
+                ++active_;
+            }
+
+            // job_ stays set until every index has been run and no worker is in here.
+            std::uint64_t stolen = 0;
+            std::size_t finished = 0;
+            for (;;) {
+                std::optional<std::size_t> index = takeOwn(worker);
+                if (!index) {
+                    index = steal(worker);
+                    if (!index) break;
+                    ++stolen;
+                }
+                try {
+                    job_(*index, worker);
+                } catch (...) {
+                    std::lock_guard lock(mutex_);
+                    if (!failure_) failure_ = std::current_exception();
+                }
+                ++finished;
+            }
+
+            std::lock_guard lock(mutex_);
+            steals_ += stolen;
+            remaining_ -= finished;
+            --active_;
+            if (remaining_ == 0 && active_ == 0) done_.notify_all();
+        }
+    }
+};
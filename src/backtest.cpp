@@ -0,0 +1,314 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "backtest.h"
+#include "workStealingPool.h"
+
+// Runs a grid of random-flow scenarios, each over several seeds, as independent books on a
+// work-stealing pool, and reports them aggregated per scenario.
+//   OrderBookBacktest [--spread LIST] [--band LIST] [--mix LIST] [--market LIST] [--qty-dist LIST] [--qty-max LIST]
+//                     [--seeds N] [--seed-base N] [--ops N] [--threads N] [--csv FILE] [--verify] [--scaling]
+// Each grid option takes a comma-separated list and the grid is every combination of them.
+// Results depend only on the scenario and seed, never on the thread count: --verify reruns the
+// grid on one thread and compares, --scaling reruns it at 1, 2, 4, ... threads.
+
+static void usage(const char* program) {
+    std::cerr << "usage: " << program << " [--spread LIST] [--band LIST] [--mix LIST] [--market LIST] [--qty-dist LIST] [--qty-max LIST]\n"
+              << "       " << std::string(std::string(program).size(), ' ')
+              << " [--seeds N] [--seed-base N] [--ops N] [--threads N] [--csv FILE] [--verify] [--scaling]\n"
+              << "  --spread 1,5,50        half-spread in ticks (default 50)\n"
+              << "  --band 10,100          width of each side's passive band in ticks (default 100)\n"
+              << "  --mix 70/15/15,40/50/10  add/cancel/modify percentages (default 70/15/15)\n"
+              << "  --market 0,5           share of adds that are market orders (default 5)\n"
+              << "  --qty-dist uniform,log-uniform  order sizes (default uniform)\n"
+              << "  --qty-max 100          largest order size (default 100)\n"
+              << "  --seeds N              runs per scenario, seeds seed-base .. seed-base + N - 1 (default 4)\n"
+              << "  --threads N            pool size, 0 for one per hardware thread (default 0)\n";
+}
+
+static std::vector<std::string> splitList(const std::string& text) {
+    std::vector<std::string> items;
+    std::istringstream in(text);
+    for (std::string item; std::getline(in, item, ',');) {
+        if (!item.empty()) items.push_back(item);
+    }
+    if (items.empty()) throw std::invalid_argument("empty list '" + text + "'");
+    return items;
+}
+
+static std::vector<std::int64_t> integerList(const std::string& text) {
+    std::vector<std::int64_t> values;
+    for (const std::string& item : splitList(text)) values.push_back(std::stoll(item));
+    return values;
+}
+
+static std::string scenarioLabel(const BacktestScenario& s) {
+    std::ostringstream out;
+    out << "spread=" << s.spreadHalf << " band=" << s.bandWidth << " mix=" << s.addPct << "/" << s.cancelPct << "/" << s.modifyPct
+        << " market=" << s.marketPct << " qty=" << sizeDistributionName(s.sizeDistribution) << "/" << s.qtyMax;
+    return out.str();
+}
+
+struct GridRun {
+    std::size_t scenario;
+    BacktestScenario parameters;
+};
+
+// Everything a run reports except its timing.
+static bool sameOutcome(const BacktestResult& a, const BacktestResult& b) {
+    return a.digest == b.digest && a.trades == b.trades && a.tradedVolume == b.tradedVolume && a.finalRestingOrders == b.finalRestingOrders
+        && a.meanSpread == b.meanSpread && a.bidDepth == b.bidDepth && a.askDepth == b.askDepth;
+}
+
+struct GridPass {
+    std::vector<BacktestResult> results;
+    double wallSeconds = 0.0;
+    std::size_t threads = 0;
+    std::uint64_t steals = 0;
+};
+
+// Each run writes only its own slot, so the results come back in grid order whatever the
+// thread count and whichever worker ran them.
+static GridPass runGrid(const std::vector<GridRun>& runs, std::size_t threads) {
+    GridPass pass;
+    pass.results.resize(runs.size());
+    WorkStealingPool pool(threads);
+    const auto start = std::chrono::steady_clock::now();
+    pool.run(runs.size(), [&](std::size_t index, std::size_t) { pass.results[index] = runBacktest(runs[index].parameters); });
+    pass.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    pass.threads = pool.getThreadCount();
+    pass.steals = pool.getStealCount();
+    return pass;
+}
+
+static bool samePass(const GridPass& a, const GridPass& b) {
+    for (std::size_t i = 0; i < a.results.size(); ++i) {
+        if (!sameOutcome(a.results[i], b.results[i])) return false;
+    }
+    return true;
+}
+
+static std::uint64_t gridDigest(const GridPass& pass) {
+    std::uint64_t digest = 0xCBF29CE484222325ULL;
+    for (const BacktestResult& result : pass.results) backtest_detail::mix(digest, result.digest);
+    return digest;
+}
+
+static void printReport(const std::vector<BacktestScenario>& scenarios, const std::vector<GridRun>& runs, const GridPass& pass,
+    std::uint64_t opsPerRun) {
+    std::cout << "BACKTEST GRID (" << scenarios.size() << " scenarios x " << runs.size() / scenarios.size() << " seeds, " << opsPerRun
+              << " ops per run, " << pass.threads << " threads)\n";
+
+    for (std::size_t s = 0; s < scenarios.size(); ++s) {
+        double trades = 0, volume = 0, resting = 0, spread = 0, opsPerSec = 0;
+        std::array<double, kBacktestDepthLevels> bids{};
+        std::array<double, kBacktestDepthLevels> asks{};
+        std::size_t count = 0;
+        for (std::size_t i = 0; i < runs.size(); ++i) {
+            if (runs[i].scenario != s) continue;
+            const BacktestResult& r = pass.results[i];
+            trades += static_cast<double>(r.trades);
+            volume += static_cast<double>(r.tradedVolume);
+            resting += static_cast<double>(r.finalRestingOrders);
+            spread += r.meanSpread;
+            opsPerSec += r.opsPerSec();
+            for (std::size_t level = 0; level < kBacktestDepthLevels; ++level) {
+                bids[level] += r.bidDepth[level];
+                asks[level] += r.askDepth[level];
+            }
+            ++count;
+        }
+        const double n = static_cast<double>(count);
+        auto profile = [n](const std::array<double, kBacktestDepthLevels>& depth) {
+            std::ostringstream out;
+            out << std::fixed << std::setprecision(0);
+            for (std::size_t level = 0; level < kBacktestDepthLevels; ++level) out << (level ? "/" : "") << depth[level] / n;
+            return out.str();
+        };
+        std::cout << scenarioLabel(scenarios[s]) << " | runs: " << count << " | trades: " << trades / n << " | traded volume: " << volume / n
+                  << " | resting: " << resting / n << " | mean spread: " << spread / n << " | ops/sec: " << opsPerSec / n << "\n"
+                  << "    bid depth L1-L" << kBacktestDepthLevels << ": " << profile(bids) << "\n"
+                  << "    ask depth L1-L" << kBacktestDepthLevels << ": " << profile(asks) << "\n";
+    }
+
+    std::cout << "Wall (s): " << pass.wallSeconds << " | steals: " << pass.steals
+              << " | grid digest: " << std::hex << gridDigest(pass) << std::dec << "\n\n";
+}
+
+static void writeCsv(const std::string& path, const std::vector<GridRun>& runs, const GridPass& pass) {
+    std::ofstream out(path);
+    out << "scenario,seed,ops,spread_half,band_width,add_pct,cancel_pct,modify_pct,market_pct,qty_dist,qty_max,"
+        << "adds,cancels,modifies,trades,traded_volume,final_resting_orders,final_bid_levels,final_ask_levels,mean_spread,seconds,ops_per_sec,digest";
+    for (std::size_t level = 1; level <= kBacktestDepthLevels; ++level) out << ",bid_depth_" << level;
+    for (std::size_t level = 1; level <= kBacktestDepthLevels; ++level) out << ",ask_depth_" << level;
+    out << "\n";
+
+    for (std::size_t i = 0; i < runs.size(); ++i) {
+        const BacktestScenario& s = runs[i].parameters;
+        const BacktestResult& r = pass.results[i];
+        out << runs[i].scenario << "," << s.seed << "," << s.numOps << "," << s.spreadHalf << "," << s.bandWidth << "," << s.addPct << ","
+            << s.cancelPct << "," << s.modifyPct << "," << s.marketPct << "," << sizeDistributionName(s.sizeDistribution) << ","
+            << s.qtyMax << "," << r.adds << "," << r.cancels << "," << r.modifies << "," << r.trades << "," << r.tradedVolume << ","
+            << r.finalRestingOrders << "," << r.finalBidLevels << "," << r.finalAskLevels << "," << r.meanSpread << "," << r.seconds << ","
+            << r.opsPerSec() << "," << std::hex << r.digest << std::dec;
+        for (const double volume : r.bidDepth) out << "," << volume;
+        for (const double volume : r.askDepth) out << "," << volume;
+        out << "\n";
+    }
+    if (!out) throw std::runtime_error("cannot write '" + path + "'");
+}
+
+int main(int argc, char** argv) {
+    std::vector<std::int64_t> spreads = { 50 };
+    std::vector<std::int64_t> bands = { 100 };
+    std::vector<std::array<int, 3>> mixes = { { 70, 15, 15 } };
+    std::vector<std::int64_t> markets = { 5 };
+    std::vector<SizeDistribution> distributions = { SizeDistribution::UNIFORM };
+    std::vector<std::int64_t> qtyMaxes = { 100 };
+    std::uint64_t seeds = 4;
+    std::uint64_t seedBase = 1;
+    std::uint64_t ops = 1'000'000ULL;
+    std::size_t threads = 0;
+    std::string csvPath;
+    bool verify = false;
+    bool scaling = false;
+
+    try {
+        for (int i = 1; i < argc; ++i) {
+            const std::string arg = argv[i];
+            auto value = [&]() -> std::string {
+                if (i + 1 >= argc) throw std::invalid_argument(arg + " needs a value");
+                return argv[++i];
+            };
+
+            if (arg == "--help" || arg == "-h") {
+                usage(argv[0]);
+                return 0;
+            } else if (arg == "--spread") {
+                spreads = integerList(value());
+            } else if (arg == "--band") {
+                bands = integerList(value());
+            } else if (arg == "--market") {
+                markets = integerList(value());
+            } else if (arg == "--qty-max") {
+                qtyMaxes = integerList(value());
+            } else if (arg == "--mix") {
+                mixes.clear();
+                for (const std::string& item : splitList(value())) {
+                    std::array<int, 3> mix{};
+                    char sep1 = 0, sep2 = 0;
+                    std::istringstream in(item);
+                    if (!(in >> mix[0] >> sep1 >> mix[1] >> sep2 >> mix[2]) || sep1 != '/' || sep2 != '/' || mix[0] + mix[1] + mix[2] != 100) {
+                        throw std::invalid_argument("--mix expects A/B/C summing to 100, got " + item);
+                    }
+                    mixes.push_back(mix);
+                }
+            } else if (arg == "--qty-dist") {
+                distributions.clear();
+                for (const std::string& item : splitList(value())) {
+                    if (item == "uniform") distributions.push_back(SizeDistribution::UNIFORM);
+                    else if (item == "log-uniform") distributions.push_back(SizeDistribution::LOG_UNIFORM);
+                    else throw std::invalid_argument("unknown size distribution " + item);
+                }
+            } else if (arg == "--seeds") {
+                seeds = std::max<std::uint64_t>(1, std::stoull(value()));
+            } else if (arg == "--seed-base") {
+                seedBase = std::stoull(value(), nullptr, 0);
+            } else if (arg == "--ops") {
+                ops = std::stoull(value());
+            } else if (arg == "--threads") {
+                threads = std::stoull(value());
+            } else if (arg == "--csv") {
+                csvPath = value();
+            } else if (arg == "--verify") {
+                verify = true;
+            } else if (arg == "--scaling") {
+                scaling = true;
+            } else {
+                usage(argv[0]);
+                return 2;
+            }
+        }
+    } catch (const std::exception& error) {
+        std::cerr << error.what() << "\n";
+        return 2;
+    }
+
+    std::vector<BacktestScenario> scenarios;
+    for (const std::int64_t spread : spreads)
+        for (const std::int64_t band : bands)
+            for (const auto& mix : mixes)
+                for (const std::int64_t market : markets)
+                    for (const SizeDistribution distribution : distributions)
+                        for (const std::int64_t qtyMax : qtyMaxes) {
+                            BacktestScenario scenario;
+                            scenario.numOps = ops;
+                            scenario.spreadHalf = spread;
+                            scenario.bandWidth = band;
+                            scenario.modifyRange = spread + band + 150; // 300 for the defaults, as in the benchmark
+                            scenario.addPct = mix[0];
+                            scenario.cancelPct = mix[1];
+                            scenario.modifyPct = mix[2];
+                            scenario.marketPct = static_cast<int>(market);
+                            scenario.sizeDistribution = distribution;
+                            scenario.qtyMax = static_cast<Quantity>(std::max<std::int64_t>(1, qtyMax));
+                            scenarios.push_back(scenario);
+                        }
+
+    std::vector<GridRun> runs;
+    for (std::size_t s = 0; s < scenarios.size(); ++s) {
+        for (std::uint64_t k = 0; k < seeds; ++k) {
+            GridRun run{ s, scenarios[s] };
+            run.parameters.seed = seedBase + k;
+            runs.push_back(run);
+        }
+    }
+
+    try {
+        const GridPass pass = runGrid(runs, threads);
+        printReport(scenarios, runs, pass, ops);
+        if (!csvPath.empty()) writeCsv(csvPath, runs, pass);
+
+        bool consistent = true;
+        if (verify) {
+            const GridPass single = runGrid(runs, 1);
+            const bool same = samePass(pass, single);
+            consistent = consistent && same;
+            std::cout << "Same results on 1 thread as on " << pass.threads << ": " << (same ? "yes" : "NO") << "\n";
+        }
+        if (scaling) {
+            const std::size_t hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+            std::vector<std::size_t> counts;
+            for (std::size_t n = 1; n < hardwareThreads; n *= 2) counts.push_back(n);
+            counts.push_back(hardwareThreads);
+
+            std::cout << "SCALING (" << runs.size() << " runs, " << hardwareThreads << " hardware threads)\n";
+            double oneThreadWall = 0.0;
+            for (const std::size_t count : counts) {
+                const GridPass scaled = runGrid(runs, count);
+                if (count == 1) oneThreadWall = scaled.wallSeconds;
+                const bool same = samePass(pass, scaled);
+                consistent = consistent && same;
+                std::cout << count << " threads | wall (s): " << scaled.wallSeconds << " | speedup: " << oneThreadWall / scaled.wallSeconds
+                          << " | per thread: " << oneThreadWall / scaled.wallSeconds / static_cast<double>(count)
+                          << " | steals: " << scaled.steals << " | same results: " << (same ? "yes" : "NO") << "\n";
+            }
+            std::cout << "\n";
+        }
+        return consistent ? 0 : 1;
+    } catch (const std::exception& error) {
+        std::cerr << "error: " << error.what() << "\n";
+        return 1;
+    }
+}
@@ -1,12 +1,55 @@
 #include <algorithm>
+#include <bit>
+#include <atomic>
 #include <chrono>
+#include <cmath>
 #include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <new>
+#include <numeric>
+#include <optional>
 #include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <type_traits>
 #include <vector>
 
+#include "command.h"
+#include "depthMirror.h"
+#include "feedBook.h"
+#include "journal.h"
+#include "marketDataRing.h"
+#include "matchingEngine.h"
 #include "orderBook.h"
+#include "perfCounters.h"
+#include "pipeline.h"
+#include "randomFlow.h"
+#include "snapshot.h"
+#include "soaPriceLevel.h"
+#include "topOfBook.h"
+#include "tradeAnalytics.h"
 
+// Counts every global heap allocation so the steady-state phase can show it does none.
+// Kept out of line so GCC doesn't pair the inlined free() with operator new and warn.
+static std::atomic<std::uint64_t> gHeapAllocations{ 0 };
+
+[[gnu::noinline]] void* operator new(std::size_t size) {
+    gHeapAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size ? size : 1)) return ptr;
+    throw std::bad_alloc();
+}
+
+[[gnu::noinline]] void operator delete(void* ptr) noexcept { std::free(ptr); }
+[[gnu::noinline]] void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+
+// Everything below covers the measured ops only; the warmup ops before them are not counted.
 struct BenchmarkResult {
     double seconds = 0.0;
     std::uint64_t ops = 0;
@@ -16,151 +59,2097 @@ struct BenchmarkResult {
     std::uint64_t trades = 0;
     std::size_t finalRestingOrders = 0;
     std::size_t trackedActiveIds = 0;
+    // Measured after the warmup ops, once the book has reached its working set.
+    std::uint64_t steadyHeapAllocations = 0;
+    std::uint64_t steadyPoolChunkAllocations = 0;
+    // Wall time spent inside cancelOrder/modifyOrder calls.
+    double cancelNanos = 0.0;
+    double modifyNanos = 0.0;
+    // Modifies the book rejected, almost all for ids that had already filled.
+    std::uint64_t modifyRejects = 0;
+    // Time the depth consumer spends keeping its view current, and whether that view
+    // still matches the book at the end of the run.
+    double depthNanos = 0.0;
+    bool depthViewMatches = true;
+    // Only filled in when the profile journals (the final depth also when it publishes a feed).
+    std::uint64_t journalRecords = 0;
+    std::uint64_t journalWarmupRecords = 0; // records written before the measured ops
+    std::vector<OrderBook::BookLevel> finalBids;
+    std::vector<OrderBook::BookLevel> finalAsks;
+    // Only filled in when the book carries TradeAnalytics: its totals and the bars it closed.
+    std::uint64_t analyticsTrades = 0;
+    Quantity analyticsVolume = 0;
+    std::optional<double> analyticsVwap;
+    std::size_t analyticsBars = 0;
+    // Records the feed published over the measured ops.
+    std::uint64_t feedRecords = 0;
+    // Book-internal histograms over the measured ops; empty unless built with ORDERBOOK_STATS.
+    OrderBookStats latency;
+    // Hardware counters (see PerfCapture): the whole measured phase, and per op type when
+    // each call is bracketed. perfEvents has bit i set for each PerfEvent that was counted.
+    std::uint32_t perfEvents = 0;
+    bool perfMultiplexed = false;
+    std::string perfError;
+    PerfSample perfPhase;
+    PerfSample perfAdd;
+    PerfSample perfCancel;
+    PerfSample perfModify;
+
+    double opsPerSec() const { return seconds > 0.0 ? static_cast<double>(ops) / seconds : 0.0; }
 };
 
-static BenchmarkResult runBenchmark() {
-    using Clock = std::chrono::steady_clock;
+static constexpr std::size_t kAllLevels = std::size_t{ 1 } << 20;
+
+static bool sameDepth(const std::vector<OrderBook::BookLevel>& lhs, const std::vector<OrderBook::BookLevel>& rhs) {
+    return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), [](const auto& a, const auto& b) {
+        return a.price == b.price && a.volume == b.volume;
+    });
+}
 
-    constexpr std::uint64_t kNumOps = 10'000'000ULL;
-    constexpr std::uint64_t kSeed = 0xC0FFEEULL;
-    constexpr std::size_t kMaxActiveIds = 200000;
+// How a market-data consumer keeps its view of the top of the book current.
+enum class DepthConsumer { NONE, POLL_DEPTH, MIRROR };
 
-    // Action mix (percent)
-    constexpr int kAddPct = 70;
-    constexpr int kCancelPct = 15;
-    constexpr int kModifyPct = 15;
-    static_assert(kAddPct + kCancelPct + kModifyPct == 100);
+// PHASE reads the counters at the start and end of the measured ops; PER_OP also reads them
+// around every book call to split the cost by op type, which adds two syscalls per op.
+enum class PerfCapture { OFF, PHASE, PER_OP };
 
-    // Order mix
-    constexpr int kMarketPct = 5; // small % to exercise matching
+// A named flow for the suite: its shape, how long to run it, and what to measure alongside.
+struct WorkloadProfile : FlowProfile {
+    std::string name = "default";
+    std::string description = "70/15/15 add/cancel/modify, 5% market orders";
+    std::uint64_t numOps = 10'000'000ULL;
+    std::uint64_t warmupOps = 1'000'000ULL;
+    std::uint64_t seed = 0xC0FFEEULL;
+    // Emulate amends the old way, with cancelOrder + addOrder from the caller.
+    bool amendByReplace = false;
+    DepthConsumer depthConsumer = DepthConsumer::NONE;
+    std::size_t depthLevels = 10;
+    PerfCapture perfCapture = PerfCapture::OFF;
+    // Journal every accepted command to this file (and keep the final depth to check replays against).
+    const char* journalPath = nullptr;
+    // Publish the book's order events and level updates to this ring from the start (replaces
+    // the handler a MIRROR depth consumer would set, so don't combine the two).
+    MarketDataPublisher* feed = nullptr;
+};
 
-    OrderBook orderBook;
-    std::vector<OrderId> activeOrderIds;
-    activeOrderIds.reserve(std::min<std::size_t>(kMaxActiveIds, 100000));
-    OrderId nextOrderId = 1;
+// Named flows for the suite. Each starts from the default and changes only what makes it distinct.
+static std::vector<WorkloadProfile> namedProfiles() {
+    std::vector<WorkloadProfile> profiles;
+    profiles.push_back(WorkloadProfile{});
 
-    std::mt19937_64 rng(kSeed);
+    WorkloadProfile cancelStorm;
+    cancelStorm.name = "cancel-storm";
+    cancelStorm.description = "quotes pulled almost as fast as they arrive: 35/60/5 mix, deep prefilled book";
+    cancelStorm.addPct = 35;
+    cancelStorm.cancelPct = 60;
+    cancelStorm.modifyPct = 5;
+    cancelStorm.prefillOrders = 150'000;
+    profiles.push_back(cancelStorm);
 
-    Price centerPrice = 10000;
-    Price spreadHalf = 50;
+    WorkloadProfile deepSweep;
+    deepSweep.name = "deep-sweep";
+    deepSweep.description = "thin levels over a 1000-tick band; 2% market orders 40x normal size sweep many of them";
+    deepSweep.marketPct = 2;
+    deepSweep.marketQtyScale = 40;
+    deepSweep.bandWidth = 1000;
+    deepSweep.maxTrackedOrders = 20'000;
+    deepSweep.prefillOrders = 20'000;
+    profiles.push_back(deepSweep);
 
-    std::uniform_int_distribution<Price> priceDistBuy(centerPrice - spreadHalf - 100, centerPrice - spreadHalf);
-    std::uniform_int_distribution<Price> priceDistSell(centerPrice + spreadHalf, centerPrice + spreadHalf + 100);
-    std::uniform_int_distribution<Price> priceDistAny(centerPrice - 300, centerPrice + 300);
-    std::uniform_int_distribution<Quantity> quantityDist(1, 100);
-    std::uniform_int_distribution<int> sideDist(0, 1);
-    std::uniform_int_distribution<int> actionDist(0, 99);
-    std::uniform_int_distribution<int> pctDist(0, 99);
+    WorkloadProfile narrow;
+    narrow.name = "narrow-book";
+    narrow.description = "one-tick spread, every passive order within 5 ticks of the touch";
+    narrow.spreadHalf = 1;
+    narrow.bandWidth = 5;
+    narrow.modifyRange = 6;
+    profiles.push_back(narrow);
+
+    WorkloadProfile wide;
+    wide.name = "wide-book";
+    wide.description = "passive orders spread over 5000 ticks per side, heavy-tailed sizes";
+    wide.bandWidth = 5000;
+    wide.modifyRange = 5050;
+    wide.sizeDistribution = SizeDistribution::LOG_UNIFORM;
+    wide.qtyMax = 10'000;
+    profiles.push_back(wide);
+
+    WorkloadProfile modifyHeavy;
+    modifyHeavy.name = "modify-heavy";
+    modifyHeavy.description = "40/10/50 mix, 80% of modifies shrink size in place";
+    modifyHeavy.addPct = 40;
+    modifyHeavy.cancelPct = 10;
+    modifyHeavy.modifyPct = 50;
+    modifyHeavy.amendPct = 80;
+    profiles.push_back(modifyHeavy);
+
+    WorkloadProfile staleAmend;
+    staleAmend.name = "stale-amend";
+    staleAmend.description = "30% of modifies target orders that already filled, each rejected as an unknown id";
+    staleAmend.staleModifyPct = 30;
+    profiles.push_back(staleAmend);
+
+    WorkloadProfile immediate;
+    immediate.name = "ioc-fok";
+    immediate.description = "30% of adds are aggressive IOC/FOK limits, half of them fill-or-kill";
+    immediate.marketPct = 0;
+    immediate.iocPct = 15;
+    immediate.fokPct = 15;
+    profiles.push_back(immediate);
+
+    WorkloadProfile fokHeavy;
+    fokHeavy.name = "fok-heavy";
+    fokHeavy.description = "deep 1000-tick book; 30% of adds are fill-or-kill orders bigger than the book, rejected after the check";
+    fokHeavy.marketPct = 0;
+    fokHeavy.fokPct = 30;
+    fokHeavy.immediateQtyScale = 10'000'000;
+    fokHeavy.bandWidth = 1000;
+    fokHeavy.prefillOrders = 150'000;
+    profiles.push_back(fokHeavy);
+
+    return profiles;
+}
+
+// Op index as the analytics clock: one bar per this many ops.
+static constexpr std::int64_t kAnalyticsBarOps = 10'000;
+
+template <typename Book = OrderBook>
+static BenchmarkResult runBenchmark(const OrderBookConfig& config, const WorkloadProfile& profile = {}) {
+    using Clock = std::chrono::steady_clock;
+    constexpr bool kAnalytics = std::is_same_v<typename Book::Analytics, TradeAnalytics>;
+
+    Book orderBook(config);
+    if (profile.feed) profile.feed->attach(orderBook);
+    if constexpr (kAnalytics) {
+        orderBook.getAnalytics().configureBars(kAnalyticsBarOps, static_cast<std::size_t>(profile.numOps / kAnalyticsBarOps) + 1);
+    }
+    RandomFlow flow(profile, profile.seed);
 
     BenchmarkResult result;
-    const auto start = Clock::now();
 
-    auto addOrder = [&]() {
-        const Side side = (sideDist(rng) == 0) ? Side::BUY : Side::SELL;
-        const bool isMarket = (pctDist(rng) < kMarketPct);
-        const OrderType type = isMarket ? OrderType::MARKET : OrderType::LIMIT;
-        const TimeInForce tif = isMarket ? TimeInForce::IOC : TimeInForce::GTC;
+    std::optional<JournalWriter> journal;
+    if (profile.journalPath) journal.emplace(profile.journalPath);
+
+    DepthMirror mirror;
+    if (profile.depthConsumer == DepthConsumer::MIRROR) {
+        orderBook.setLevelUpdateHandler([&](std::span<const LevelUpdate> updates) {
+            const auto applyStart = Clock::now();
+            mirror.apply(updates);
+            result.depthNanos += std::chrono::duration<double, std::nano>(Clock::now() - applyStart).count();
+        });
+    }
+    Quantity depthChecksum = 0;
+
+    std::optional<PerfCounters> perf;
+    if (profile.perfCapture != PerfCapture::OFF) perf.emplace();
+    const bool perfPerOp = profile.perfCapture == PerfCapture::PER_OP && perf->available();
+    auto perfRead = [&]() { return perfPerOp ? perf->read() : PerfSample{}; };
 
-        const Price price = isMarket ? 0 : ((side == Side::BUY) ? priceDistBuy(rng) : priceDistSell(rng));
-        const Quantity qty = quantityDist(rng);
-        const OrderId id = nextOrderId++;
+    // Adds are journaled after the book accepts them, as the order stood on arrival.
+    auto submit = [&](Order& order) {
+        const Command command = Command::add(order);
+        std::uint64_t fills = 0;
+        const PerfSample before = perfRead();
+        const OrderResult added = orderBook.addOrder(order, [&fills](const Trade&) { ++fills; });
+        if (perfPerOp) result.perfAdd += perf->read() - before;
+        if (journal && added.accepted()) journal->append(command);
+        flow.onAdded(order, added);
+        return fills;
+    };
 
-        Order order(id, side, type, price, qty, tif);
-        const auto trades = orderBook.addOrder(order);
+    for (std::uint64_t i = 0; flow.wantsPrefill(i); ++i) {
+        Order order = flow.nextPrefill(i);
+        submit(order);
+    }
+    result.perfAdd = PerfSample{};
 
+    auto addOrder = [&]() {
+        Order order = flow.nextAdd();
+        result.trades += submit(order);
         result.ops++;
         result.adds++;
-        result.trades += static_cast<std::uint64_t>(trades.size());
-
-        if (type == OrderType::LIMIT && tif == TimeInForce::GTC && !order.isFilled()) {
-            activeOrderIds.push_back(id);
-        }
     };
 
     auto cancelOrder = [&]() {
-        if (activeOrderIds.empty()) {
+        const std::optional<std::size_t> idx = flow.nextCancel();
+        if (!idx) {
             return;
         }
+        const OrderId id = flow.getTracked(*idx).id;
 
-        const std::size_t idx = std::uniform_int_distribution<std::size_t>(0, activeOrderIds.size() - 1)(rng);
-        const OrderId id = activeOrderIds[idx];
-
-        (void)orderBook.cancelOrder(id);
-        activeOrderIds[idx] = activeOrderIds.back();
-        activeOrderIds.pop_back();
+        const PerfSample before = perfRead();
+        const auto callStart = Clock::now();
+        const bool cancelled = orderBook.cancelOrder(id).accepted();
+        result.cancelNanos += std::chrono::duration<double, std::nano>(Clock::now() - callStart).count();
+        if (perfPerOp) result.perfCancel += perf->read() - before;
+        if (cancelled && journal) journal->append(Command::cancel(id));
+        flow.onCancelled(*idx);
 
         result.ops++;
         result.cancels++;
     };
 
     auto modifyOrder = [&]() {
-        if (activeOrderIds.empty()) {
+        const std::optional<FlowModify> step = flow.nextModify();
+        if (!step) {
             return;
         }
+        const OrderModify& mod = step->modify;
+
+        std::uint64_t fills = 0;
+        auto countFills = [&fills](const Trade&) { ++fills; };
 
-        const std::size_t idx = std::uniform_int_distribution<std::size_t>(0, activeOrderIds.size() - 1)(rng);
-        const OrderId id = activeOrderIds[idx];
+        const PerfSample before = perfRead();
+        auto chargePerf = [&]() {
+            if (perfPerOp) result.perfModify += perf->read() - before;
+        };
 
-        const Quantity newQty = quantityDist(rng);
-        const Price newPrice = priceDistAny(rng);
-        const OrderModify mod{ id, newPrice, newQty };
+        const auto callStart = Clock::now();
+        if (profile.amendByReplace && !step->stale) {
+            const ActiveOrder active = flow.getTracked(step->index);
+            const bool found = orderBook.cancelOrder(active.id).accepted();
+            if (found) {
+                Order replacement(active.id, active.side, OrderType::LIMIT, mod.price_, mod.quantity_, TimeInForce::GTC);
+                const Command add = Command::add(replacement);
+                const bool added = orderBook.addOrder(replacement, countFills).accepted();
+                if (journal) {
+                    journal->append(Command::cancel(active.id));
+                    if (added) journal->append(add);
+                }
+            }
+            result.modifyNanos += std::chrono::duration<double, std::nano>(Clock::now() - callStart).count();
+            chargePerf();
+            result.trades += fills;
 
-        try {
-            const auto trades = orderBook.modifyOrder(mod);
-            result.trades += static_cast<std::uint64_t>(trades.size());
-            // If it traded, the order may have been fully filled; stop tracking to reduce stale IDs.
-            if (!trades.empty()) {
-                activeOrderIds[idx] = activeOrderIds.back();
-                activeOrderIds.pop_back();
+            if (!found) result.modifyRejects++;
+            // A caller replacing by hand stops tracking an order once its replacement trades.
+            flow.onModified(*step, found && fills == 0);
+        } else {
+            const OrderResult modified = orderBook.modifyOrder(mod, countFills);
+            result.modifyNanos += std::chrono::duration<double, std::nano>(Clock::now() - callStart).count();
+            chargePerf();
+            result.trades += fills;
+            if (modified.accepted()) {
+                if (journal) journal->append(Command::modify(mod));
+            } else {
+                result.modifyRejects++;
             }
-        } catch (...) {
-            // Order likely already gone; drop it from tracking.
-            activeOrderIds[idx] = activeOrderIds.back();
-            activeOrderIds.pop_back();
+            // Gone: filled by this modify, or (rejected) by an earlier aggressor.
+            flow.onModified(*step, modified.resting);
         }
 
         result.ops++;
         result.modifies++;
     };
 
-    for (std::uint64_t i = 0; i < kNumOps; ++i) {
-        // Keep tracking bounded so we don't benchmark vector growth.
-        if (activeOrderIds.size() > kMaxActiveIds) {
-            cancelOrder();
-            continue;
+    std::uint64_t warmHeapAllocations = gHeapAllocations.load(std::memory_order_relaxed);
+    std::uint64_t warmPoolChunkAllocations = orderBook.getOrderPoolStats().chunkAllocations;
+    if (perf) perf->start();
+    PerfSample perfStart = perf ? perf->read() : PerfSample{};
+    auto start = Clock::now();
+    std::uint64_t journalWarmupRecords = journal ? journal->getRecordCount() : 0;
+    std::uint64_t feedWarmupRecords = profile.feed ? profile.feed->getPublished() : 0;
+
+    const std::uint64_t totalOps = profile.warmupOps + profile.numOps;
+    for (std::uint64_t i = 0; i < totalOps; ++i) {
+        if (i == profile.warmupOps && i > 0) {
+            result = BenchmarkResult{};
+            warmHeapAllocations = gHeapAllocations.load(std::memory_order_relaxed);
+            warmPoolChunkAllocations = orderBook.getOrderPoolStats().chunkAllocations;
+            orderBook.resetStats();
+            if constexpr (kAnalytics) orderBook.getAnalytics().reset();
+            if (perf) perfStart = perf->read();
+            if (journal) journalWarmupRecords = journal->getRecordCount();
+            if (profile.feed) feedWarmupRecords = profile.feed->getPublished();
+            start = Clock::now();
         }
 
-        const int action = actionDist(rng);
-        if (action < kAddPct) {
+        if constexpr (kAnalytics) orderBook.getAnalytics().setTime(static_cast<std::int64_t>(i));
+
+        // The flow only cancels while it tracks too many orders, so we don't benchmark vector growth.
+        switch (flow.nextAction()) {
+        case FlowAction::ADD:
             addOrder();
-        } else if (action < kAddPct + kCancelPct) {
+            break;
+        case FlowAction::CANCEL:
             cancelOrder();
-        } else {
+            break;
+        case FlowAction::MODIFY:
             modifyOrder();
+            break;
+        }
+
+        if (profile.depthConsumer == DepthConsumer::POLL_DEPTH) {
+            const auto pollStart = Clock::now();
+            for (const auto& level : orderBook.getBidDepth(profile.depthLevels)) depthChecksum += level.volume;
+            for (const auto& level : orderBook.getAskDepth(profile.depthLevels)) depthChecksum += level.volume;
+            result.depthNanos += std::chrono::duration<double, std::nano>(Clock::now() - pollStart).count();
         }
     }
 
     const auto end = Clock::now();
+    if (perf) {
+        result.perfPhase = perf->read() - perfStart;
+        perf->stop();
+        result.perfEvents = perf->eventMask();
+        result.perfMultiplexed = perf->wasMultiplexed();
+        result.perfError = perf->getError();
+    }
     const std::chrono::duration<double> elapsed = end - start;
     result.seconds = elapsed.count();
     result.finalRestingOrders = orderBook.getOrderCount();
-    result.trackedActiveIds = activeOrderIds.size();
+    result.trackedActiveIds = flow.getTrackedCount();
+    result.steadyHeapAllocations = gHeapAllocations.load(std::memory_order_relaxed) - warmHeapAllocations;
+    result.steadyPoolChunkAllocations = orderBook.getOrderPoolStats().chunkAllocations - warmPoolChunkAllocations;
+    result.latency = orderBook.getStats();
+    if constexpr (kAnalytics) {
+        const TradeAnalytics& analytics = orderBook.getAnalytics();
+        result.analyticsTrades = analytics.getTradeCount();
+        result.analyticsVolume = analytics.getVolume();
+        result.analyticsVwap = analytics.getVwap();
+        result.analyticsBars = analytics.getBarCount();
+    }
+
+    if (profile.depthConsumer == DepthConsumer::MIRROR) {
+        result.depthViewMatches = sameDepth(mirror.getBidDepth(kAllLevels), orderBook.getBidDepth(kAllLevels))
+            && sameDepth(mirror.getAskDepth(kAllLevels), orderBook.getAskDepth(kAllLevels));
+    }
+
+    if (journal) {
+        result.journalRecords = journal->getRecordCount();
+        result.journalWarmupRecords = journalWarmupRecords;
+        journal->close();
+    }
+    if (profile.feed) result.feedRecords = profile.feed->getPublished() - feedWarmupRecords;
+    if (journal || profile.feed) {
+        result.finalBids = orderBook.getBidDepth(kAllLevels);
+        result.finalAsks = orderBook.getAskDepth(kAllLevels);
+    }
+    (void)depthChecksum;
     return result;
 }
 
-int main() {
-    const BenchmarkResult result = runBenchmark();
-    const double opsPerSec = (result.seconds > 0.0) ? (static_cast<double>(result.ops) / result.seconds) : 0.0;
+static double perOp(const PerfSample& sample, PerfEvent event, std::uint64_t ops) {
+    return ops ? static_cast<double>(sample[event]) / static_cast<double>(ops) : 0.0;
+}
+
+static bool counted(const BenchmarkResult& result, PerfEvent event) {
+    return (result.perfEvents >> static_cast<unsigned>(event)) & 1;
+}
+
+static void printPerf(const BenchmarkResult& result) {
+    if (result.perfEvents == 0) {
+        std::cout << "Perf counters unavailable" << (result.perfError.empty() ? "" : " (" + result.perfError + ")") << "\n";
+        return;
+    }
+
+    const bool perType = result.perfAdd[PerfEvent::TASK_CLOCK] + result.perfAdd[PerfEvent::CYCLES] > 0;
+    std::cout << "Perf counters" << (result.perfMultiplexed ? " (multiplexed, partial coverage)" : "") << ": per op"
+              << (perType ? " | per add | per cancel | per modify" : "") << "\n";
+    for (std::size_t i = 0; i < kPerfEventCount; ++i) {
+        const auto event = static_cast<PerfEvent>(i);
+        if (!counted(result, event)) continue;
+        std::cout << "  " << perfEventName(event) << ": " << perOp(result.perfPhase, event, result.ops);
+        if (perType) {
+            std::cout << " | " << perOp(result.perfAdd, event, result.adds)
+                      << " | " << perOp(result.perfCancel, event, result.cancels)
+                      << " | " << perOp(result.perfModify, event, result.modifies);
+        }
+        std::cout << "\n";
+    }
+    if (counted(result, PerfEvent::CYCLES) && counted(result, PerfEvent::INSTRUCTIONS) && result.perfPhase[PerfEvent::CYCLES] > 0) {
+        std::cout << "  IPC: " << static_cast<double>(result.perfPhase[PerfEvent::INSTRUCTIONS]) / static_cast<double>(result.perfPhase[PerfEvent::CYCLES]) << "\n";
+    }
+    for (const PerfEvent event : { PerfEvent::CYCLES, PerfEvent::INSTRUCTIONS, PerfEvent::L1D_MISSES, PerfEvent::LLC_MISSES,
+             PerfEvent::BRANCH_MISSES, PerfEvent::DTLB_MISSES }) {
+        if (!counted(result, event)) {
+            std::cout << "  (no hardware counters" << (result.perfError.empty() ? "" : ": " + result.perfError) << ")\n";
+            break;
+        }
+    }
+}
 
+static void printResult(const char* label, const BenchmarkResult& result, PerfCapture perfCapture = PerfCapture::OFF) {
     std::cout
-        << "BENCHMARK\n"
+        << "BENCHMARK (" << label << ")\n"
         << "Seconds: " << result.seconds << "\n"
         << "Ops: " << result.ops << "\n"
-        << "Ops/sec: " << opsPerSec << "\n"
+        << "Ops/sec: " << result.opsPerSec() << "\n"
         << "Adds: " << result.adds << " Cancels: " << result.cancels << " Modifies: " << result.modifies << "\n"
         << "Trades: " << result.trades << "\n"
         << "Final resting orders: " << result.finalRestingOrders << "\n"
-        << "Tracked active IDs: " << result.trackedActiveIds << "\n";
+        << "Tracked active IDs: " << result.trackedActiveIds << "\n"
+        << "Steady-state heap allocations: " << result.steadyHeapAllocations
+        << " (order pool chunks: " << result.steadyPoolChunkAllocations << ")\n"
+        << "Mean cancel latency (ns): " << (result.cancels ? result.cancelNanos / result.cancels : 0.0) << "\n"
+        << "Mean modify latency (ns): " << (result.modifies ? result.modifyNanos / result.modifies : 0.0) << "\n"
+        << "Rejected modifies: " << result.modifyRejects << "\n"
+        << "Depth consumer time per op (ns): " << (result.ops ? result.depthNanos / result.ops : 0.0) << "\n"
+        << "Depth view matches book: " << (result.depthViewMatches ? "yes" : "NO") << "\n";
+
+    if constexpr (OrderBook::kStatsEnabled) {
+        auto printHistogram = [](const char* name, const Histogram& histogram) {
+            std::cout << "  " << name << ": n=" << histogram.count()
+                      << " p50=" << histogram.percentile(0.50)
+                      << " p99=" << histogram.percentile(0.99)
+                      << " p99.9=" << histogram.percentile(0.999)
+                      << " max=" << histogram.max() << "\n";
+        };
+        std::cout << "Book latency (ns):\n";
+        printHistogram("add", result.latency.addNanos);
+        printHistogram("cancel", result.latency.cancelNanos);
+        printHistogram("modify", result.latency.modifyNanos);
+        printHistogram("match", result.latency.matchNanos);
+        std::cout << "Match sweep (per trading match):\n";
+        printHistogram("levels", result.latency.levelsSwept);
+        printHistogram("orders", result.latency.ordersTouched);
+    }
+    if (perfCapture != PerfCapture::OFF) printPerf(result);
+    std::cout << "\n";
+}
+
+struct SymbolCommand {
+    SymbolId symbol;
+    Command command;
+};
+
+// Same flow as runBenchmark (70/15/15 mix, 5% market orders) spread uniformly over many
+// symbols, generated up front so the timed loop is pure submission.
+static std::vector<SymbolCommand> generateMultiSymbolFlow(std::size_t symbolCount, std::uint64_t numOps, std::uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<std::size_t> symbolDist(0, symbolCount - 1);
+    std::uniform_int_distribution<Price> priceDistBuy(9850, 9950);
+    std::uniform_int_distribution<Price> priceDistSell(10050, 10150);
+    std::uniform_int_distribution<Price> priceDistAny(9700, 10300);
+    std::uniform_int_distribution<Quantity> quantityDist(1, 100);
+    std::uniform_int_distribution<int> pctDist(0, 99);
+
+    std::vector<std::vector<OrderId>> activeIds(symbolCount);
+    std::vector<SymbolCommand> flow;
+    flow.reserve(numOps);
+    OrderId nextOrderId = 1;
+
+    for (std::uint64_t i = 0; i < numOps; ++i) {
+        const SymbolId symbol = static_cast<SymbolId>(symbolDist(rng));
+        auto& active = activeIds[symbol];
+        const int action = pctDist(rng);
+
+        if (action < 70 || active.empty()) {
+            const Side side = (pctDist(rng) < 50) ? Side::BUY : Side::SELL;
+            const bool isMarket = pctDist(rng) < 5;
+            const Price price = isMarket ? 0 : ((side == Side::BUY) ? priceDistBuy(rng) : priceDistSell(rng));
+            const Order order(nextOrderId++, side, isMarket ? OrderType::MARKET : OrderType::LIMIT, price, quantityDist(rng),
+                isMarket ? TimeInForce::IOC : TimeInForce::GTC);
+            flow.push_back(SymbolCommand{ symbol, Command::add(order) });
+            if (!isMarket) active.push_back(order.id);
+            continue;
+        }
+
+        const std::size_t idx = std::uniform_int_distribution<std::size_t>(0, active.size() - 1)(rng);
+        if (action < 85) {
+            flow.push_back(SymbolCommand{ symbol, Command::cancel(active[idx]) });
+            active[idx] = active.back();
+            active.pop_back();
+        } else {
+            flow.push_back(SymbolCommand{ symbol, Command::modify(OrderModify{ active[idx], priceDistAny(rng), quantityDist(rng) }) });
+        }
+    }
+    return flow;
+}
+
+static void runEngineBenchmark(std::size_t symbolCount, std::uint64_t numOps) {
+    using Clock = std::chrono::steady_clock;
+
+    const std::vector<SymbolCommand> flow = generateMultiSymbolFlow(symbolCount, numOps, 0xC0FFEEULL);
+
+    // Leave a core for the ingress thread where there is one to spare.
+    const std::size_t hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+    const std::size_t maxShards = std::max<std::size_t>(1, hardwareThreads - 1);
+
+    std::vector<std::size_t> shardCounts;
+    for (std::size_t shards = 1; shards < maxShards; shards *= 2) shardCounts.push_back(shards);
+    shardCounts.push_back(maxShards);
+
+    std::cout << "MULTI-SYMBOL ENGINE (" << symbolCount << " symbols, " << numOps << " ops, "
+              << hardwareThreads << " hardware threads)\n";
+
+    double baseOpsPerSec = 0.0;
+    for (const std::size_t shards : shardCounts) {
+        MatchingEngineConfig config;
+        config.shardCount = shards;
+        config.firstCore = 1;
+        config.bookConfig = OrderBookConfig{ .ladderBase = 10000 - 512, .ladderTicks = 1024, .idIndex = IdIndexKind::FLAT_HASH };
+
+        MatchingEngine engine(config);
+        for (std::size_t i = 0; i < symbolCount; ++i) {
+            engine.addSymbol("SYM" + std::to_string(i));
+        }
+        engine.start();
+
+        const auto start = Clock::now();
+        for (const SymbolCommand& entry : flow) {
+            engine.submit(entry.symbol, entry.command);
+        }
+        engine.waitIdle();
+        const std::chrono::duration<double> elapsed = Clock::now() - start;
+
+        const MatchingEngine::ShardStats stats = engine.getTotalStats();
+        std::size_t resting = 0;
+        for (SymbolId symbol = 0; symbol < symbolCount; ++symbol) {
+            resting += engine.getBook(symbol).getOrderCount();
+        }
+        engine.stop();
+
+        const double opsPerSec = elapsed.count() > 0.0 ? static_cast<double>(stats.commands) / elapsed.count() : 0.0;
+        if (baseOpsPerSec == 0.0) baseOpsPerSec = opsPerSec;
+
+        std::cout << "Shards: " << shards
+                  << " | Seconds: " << elapsed.count()
+                  << " | Aggregate ops/sec: " << opsPerSec
+                  << " | Scaling: " << (baseOpsPerSec > 0.0 ? opsPerSec / baseOpsPerSec : 0.0) << "x"
+                  << " | Trades: " << stats.trades
+                  << " | Rejects: " << stats.rejects
+                  << " | Resting: " << resting << "\n";
+    }
+    std::cout << "\n";
+}
+
+static void printLatencyPercentiles(const char* label, std::vector<std::int64_t>& nanos) {
+    if (nanos.empty()) return;
+    std::sort(nanos.begin(), nanos.end());
+    auto at = [&](double quantile) { return nanos[static_cast<std::size_t>(quantile * static_cast<double>(nanos.size() - 1))]; };
+    std::cout << label << " latency (ns): p50 " << at(0.50) << " | p99 " << at(0.99) << " | p99.9 " << at(0.999)
+              << " | max " << nanos.back() << "\n";
+}
+
+// One book fed the same single-symbol flow two ways: direct calls on this thread, and the
+// decode -> match -> publish pipeline. Latency is from the command being handed to the
+// engine until its completion is visible to the consumer.
+static void runPipelineBenchmark(std::uint64_t numOps) {
+    using Clock = std::chrono::steady_clock;
+
+    std::vector<Command> flow;
+    flow.reserve(numOps);
+    for (const SymbolCommand& entry : generateMultiSymbolFlow(1, numOps, 0xC0FFEEULL)) {
+        flow.push_back(entry.command);
+    }
+
+    const OrderBookConfig bookConfig{ .ladderBase = 10000 - 512, .ladderTicks = 1024, .orderCapacity = 1 << 18 };
+    std::vector<std::int64_t> latencies;
+    latencies.reserve(flow.size());
+
+    std::cout << "PIPELINE vs DIRECT (" << numOps << " commands)\n";
+
+    {
+        OrderBook book(bookConfig);
+        std::uint64_t trades = 0;
+        auto countTrades = [&trades](const Trade&) { ++trades; };
+
+        const auto start = Clock::now();
+        for (const Command& command : flow) {
+            const std::int64_t ingress = Pipeline::nowNanos();
+            applyCommand(book, command, countTrades);
+            latencies.push_back(Pipeline::nowNanos() - ingress);
+        }
+        const std::chrono::duration<double> elapsed = Clock::now() - start;
+
+        std::cout << "Direct | Ops/sec: " << static_cast<double>(flow.size()) / elapsed.count()
+                  << " | Trades: " << trades << " | Resting: " << book.getOrderCount() << "\n";
+        printLatencyPercentiles("Direct", latencies);
+    }
+
+    // Saturated: the decoder pushes as fast as the ring accepts, which measures throughput
+    // (latency is then mostly queueing). Paced: commands are offered at a fixed rate well
+    // below capacity, which measures the pipeline's own hand-off latency.
+    auto runPipeline = [&](const char* label, std::size_t count, double offeredPerSec) {
+        PipelineConfig config;
+        config.bookConfig = bookConfig;
+        Pipeline pipeline(config);
+
+        latencies.clear();
+        std::uint64_t trades = 0;
+        std::uint64_t levelUpdates = 0;
+        std::size_t next = 0;
+        const std::int64_t intervalNanos = offeredPerSec > 0.0 ? static_cast<std::int64_t>(1e9 / offeredPerSec) : 0;
+        std::int64_t firstNanos = 0;
+
+        const Pipeline::Stats stats = pipeline.run(
+            [&](Command& command) {
+                if (next == count) return false;
+                if (intervalNanos > 0) {
+                    if (next == 0) firstNanos = Pipeline::nowNanos();
+                    const std::int64_t due = firstNanos + static_cast<std::int64_t>(next) * intervalNanos;
+                    while (Pipeline::nowNanos() < due) std::this_thread::yield();
+                }
+                command = flow[next++];
+                return true;
+            },
+            [&](const OutputEvent& event) {
+                switch (event.type) {
+                case OutputType::TRADE: ++trades; break;
+                case OutputType::LEVEL_UPDATE: ++levelUpdates; break;
+                case OutputType::COMMAND_DONE: latencies.push_back(Pipeline::nowNanos() - event.ingressNanos); break;
+                }
+            });
+
+        std::cout << label << " | Ops/sec: " << static_cast<double>(stats.commands) / stats.seconds
+                  << " | Trades: " << trades << " | Level updates: " << levelUpdates
+                  << " | Resting: " << pipeline.getBook().getOrderCount() << "\n";
+        printLatencyPercentiles(label, latencies);
+    };
+
+    runPipeline("Pipeline (saturated)", flow.size(), 0.0);
+    runPipeline("Pipeline (paced 200k/s)", std::min<std::size_t>(flow.size(), 400'000), 200'000.0);
+    std::cout << "\n";
+}
+
+// Journals the default workload, then rebuilds the book from the journal alone and
+// checks it lands on the same final state.
+static void runJournalReplayBenchmark(const OrderBookConfig& config) {
+    using Clock = std::chrono::steady_clock;
+
+    const std::string path = (std::filesystem::temp_directory_path() / "orderbook-benchmark.journal").string();
+    WorkloadProfile journaled;
+    journaled.name = "journaled";
+    journaled.journalPath = path.c_str();
+
+    const BenchmarkResult live = runBenchmark(config, journaled);
+    printResult("default workload, journaling accepted commands", live);
+
+    OrderBook replayed(config);
+    std::uint64_t applied = 0;
+    double seconds = 0.0;
+    {
+        JournalReader reader(path);
+        const auto start = Clock::now();
+        applied = replayJournal(replayed, reader.records());
+        seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    const bool matches = replayed.getOrderCount() == live.finalRestingOrders
+        && sameDepth(replayed.getBidDepth(kAllLevels), live.finalBids)
+        && sameDepth(replayed.getAskDepth(kAllLevels), live.finalAsks);
+
+    std::cout << "JOURNAL REPLAY\n"
+              << "Journal records: " << live.journalRecords << " (" << std::filesystem::file_size(path) << " bytes)\n"
+              << "Replayed: " << applied << " in " << seconds << " s"
+              << " | Replay ops/sec: " << (seconds > 0.0 ? static_cast<double>(applied) / seconds : 0.0) << "\n"
+              << "Resting orders: " << replayed.getOrderCount() << " (live " << live.finalRestingOrders << ")\n"
+              << "Replayed book matches live book: " << (matches ? "yes" : "NO") << "\n\n";
+
+    std::filesystem::remove(path);
+}
+
+// Builds a book with restingOrders resting orders (some partly filled), snapshots it to disk
+// and loads it into a fresh book, against rebuilding the same book order by order.
+static void runSnapshotBenchmark(const OrderBookConfig& config, std::size_t restingOrders) {
+    using Clock = std::chrono::steady_clock;
+    auto secondsSince = [](Clock::time_point start) { return std::chrono::duration<double>(Clock::now() - start).count(); };
+
+    std::mt19937_64 rng(0x5EED);
+    std::uniform_int_distribution<int> offsetDist(1, 1000);
+    std::uniform_int_distribution<Quantity> qtyDist(1, 100);
+
+    std::vector<Order> flow;
+    flow.reserve(restingOrders + 2);
+    for (OrderId id = 1; id <= restingOrders; ++id) {
+        const Side side = (id & 1) ? Side::BUY : Side::SELL;
+        const Price price = side == Side::BUY ? 10000 - offsetDist(rng) : 10000 + offsetDist(rng);
+        flow.emplace_back(id, side, OrderType::LIMIT, price, qtyDist(rng), TimeInForce::GTC);
+    }
+    // Chew into the top of each side so some front orders are left partly filled.
+    flow.emplace_back(restingOrders + 1, Side::BUY, OrderType::MARKET, 0, 5'000, TimeInForce::IOC);
+    flow.emplace_back(restingOrders + 2, Side::SELL, OrderType::MARKET, 0, 5'000, TimeInForce::IOC);
+
+    OrderBook original(config);
+    auto start = Clock::now();
+    for (Order order : flow) original.addOrder(order, [](const Trade&) {});
+    const double rebuildSeconds = secondsSince(start);
+
+    const std::string path = (std::filesystem::temp_directory_path() / "orderbook-benchmark.snapshot").string();
+    start = Clock::now();
+    const std::vector<std::byte> saved = BookSnapshot::save(original);
+    writeSnapshotFile(path, saved);
+    const double saveSeconds = secondsSince(start);
+
+    OrderBook restored(config);
+    start = Clock::now();
+    const std::vector<std::byte> image = readSnapshotFile(path);
+    const double readSeconds = secondsSince(start);
+    start = Clock::now();
+    BookSnapshot::load(restored, image);
+    const double loadSeconds = secondsSince(start);
+    std::filesystem::remove(path);
+
+    // Re-snapshotting the restored book byte-for-byte covers queue order and fill state too.
+    const bool matches = BookSnapshot::save(restored) == saved
+        && sameDepth(restored.getBidDepth(kAllLevels), original.getBidDepth(kAllLevels))
+        && sameDepth(restored.getAskDepth(kAllLevels), original.getAskDepth(kAllLevels));
+
+    std::cout << "SNAPSHOT (" << original.getOrderCount() << " resting orders)\n"
+              << "Snapshot bytes: " << saved.size() << "\n"
+              << "Save + write (s): " << saveSeconds << "\n"
+              << "Read (s): " << readSeconds << " | Load (s): " << loadSeconds << "\n"
+              << "Rebuild via addOrder (s): " << rebuildSeconds << "\n"
+              << "Restored book matches original: " << (matches ? "yes" : "NO") << "\n\n";
+}
+
+// Session-end cancel of a book holding restingOrders orders over 1000 levels a side: one
+// cancelOrder per id in the order they were added, against cancelAll, cancelSide for each side
+// and cancelPriceRange over each whole side, on both id indexes. Every row starts from a
+// freshly built book, churned first so the orders sit in scattered pool slots as they do in a
+// book that has been running a while, and has to leave it empty.
+static void runMassCancelBenchmark(std::size_t restingOrders) {
+    using Clock = std::chrono::steady_clock;
+
+    std::mt19937_64 rng(0xCA9CE1ULL);
+    std::uniform_int_distribution<int> offsetDist(1, 1000);
+    std::uniform_int_distribution<Quantity> qtyDist(1, 100);
+    // The first half only churns the pool: added, then cancelled in random order.
+    std::vector<Order> orders;
+    orders.reserve(2 * restingOrders);
+    for (OrderId id = 1; id <= 2 * restingOrders; ++id) {
+        const Side side = (id & 1) ? Side::BUY : Side::SELL;
+        const Price price = side == Side::BUY ? 10000 - offsetDist(rng) : 10000 + offsetDist(rng);
+        orders.emplace_back(id, side, OrderType::LIMIT, price, qtyDist(rng), TimeInForce::GTC);
+    }
+    std::vector<OrderId> churnIds(restingOrders);
+    std::iota(churnIds.begin(), churnIds.end(), OrderId{ 1 });
+    std::shuffle(churnIds.begin(), churnIds.end(), rng);
+    const std::span<const Order> resting(orders.data() + restingOrders, restingOrders);
+    const OrderId expectedIdSum = restingOrders * (3 * restingOrders + 1) / 2;
+
+    enum class Method { PER_ORDER, ALL, BY_SIDE, BY_RANGE };
+    const std::pair<Method, const char*> methods[] = {
+        { Method::PER_ORDER, "cancelOrder per id" },
+        { Method::ALL, "cancelAll" },
+        { Method::BY_SIDE, "cancelSide x2" },
+        { Method::BY_RANGE, "cancelPriceRange x2" },
+    };
+
+    std::cout << "MASS CANCEL (" << restingOrders << " resting orders, 1000 levels a side)\n";
+    for (const IdIndexKind kind : { IdIndexKind::FLAT_HASH, IdIndexKind::DENSE_WINDOW }) {
+        const OrderBookConfig config{ .ladderBase = 10000 - 1024, .ladderTicks = 2048, .orderCapacity = restingOrders, .idIndex = kind };
+        const char* indexName = kind == IdIndexKind::FLAT_HASH ? "flat hash" : "dense ids";
+
+        double perOrderSeconds = 0.0;
+        for (const auto& [method, name] : methods) {
+            OrderBook book(config);
+            for (Order order : orders) book.addOrder(order, [](const Trade&) {});
+            for (const OrderId id : churnIds) book.cancelOrder(id);
+
+            std::size_t cancelled = 0;
+            OrderId idSum = 0;
+            auto sink = [&idSum](OrderId id) { idSum += id; };
+            const auto start = Clock::now();
+            switch (method) {
+            case Method::PER_ORDER:
+                for (const Order& order : resting) {
+                    if (book.cancelOrder(order.id).accepted()) {
+                        ++cancelled;
+                        sink(order.id);
+                    }
+                }
+                break;
+            case Method::ALL:
+                cancelled = book.cancelAll(sink);
+                break;
+            case Method::BY_SIDE:
+                cancelled = book.cancelSide(Side::BUY, sink) + book.cancelSide(Side::SELL, sink);
+                break;
+            case Method::BY_RANGE:
+                cancelled = book.cancelPriceRange(Side::BUY, 0, 20000, sink) + book.cancelPriceRange(Side::SELL, 0, 20000, sink);
+                break;
+            }
+            const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+            if (method == Method::PER_ORDER) perOrderSeconds = seconds;
+
+            const bool emptied = book.isEmpty() && book.getBidDepth(1).empty() && book.getAskDepth(1).empty()
+                && cancelled == restingOrders && idSum == expectedIdSum;
+            std::cout << indexName << " | " << name << " | ms: " << seconds * 1e3
+                      << " | ns/order: " << seconds * 1e9 / static_cast<double>(restingOrders)
+                      << " | vs per-order loop: " << perOrderSeconds / seconds << "x"
+                      << " | Book emptied: " << (emptied ? "yes" : "NO") << "\n";
+        }
+    }
+    std::cout << "\n";
+}
+
+// One single-symbol flow applied with one applyCommand call per command, then through
+// processBatch in batches of 1, 8, 32 and 128, on both id indexes. Each batched run has to
+// end with exactly the sequential run's book and trade count.
+static void runBatchBenchmark(std::uint64_t numOps) {
+    using Clock = std::chrono::steady_clock;
+
+    std::vector<Command> flow;
+    flow.reserve(numOps);
+    for (const SymbolCommand& entry : generateMultiSymbolFlow(1, numOps, 0xC0FFEEULL)) {
+        flow.push_back(entry.command);
+    }
+
+    std::cout << "BATCHED PROCESSING (" << numOps << " commands, prefetch distance " << kBatchPrefetchDistance << ")\n";
+
+    for (const IdIndexKind kind : { IdIndexKind::FLAT_HASH, IdIndexKind::DENSE_WINDOW }) {
+        const OrderBookConfig config{ .ladderBase = 10000 - 512, .ladderTicks = 1024, .orderCapacity = 1 << 18, .idIndex = kind };
+        const char* indexName = kind == IdIndexKind::FLAT_HASH ? "flat hash" : "dense ids";
+
+        std::uint64_t referenceTrades = 0;
+        std::vector<OrderBook::BookLevel> referenceBids;
+        std::vector<OrderBook::BookLevel> referenceAsks;
+        double sequentialOpsPerSec = 0.0;
+        {
+            OrderBook book(config);
+            auto countTrades = [&referenceTrades](const Trade&) { ++referenceTrades; };
+            const auto start = Clock::now();
+            for (const Command& command : flow) applyCommand(book, command, countTrades);
+            const std::chrono::duration<double> elapsed = Clock::now() - start;
+
+            sequentialOpsPerSec = static_cast<double>(flow.size()) / elapsed.count();
+            referenceBids = book.getBidDepth(kAllLevels);
+            referenceAsks = book.getAskDepth(kAllLevels);
+            std::cout << indexName << " | sequential | Ops/sec: " << sequentialOpsPerSec << " | Resting: " << book.getOrderCount() << "\n";
+        }
+
+        for (const std::size_t batchSize : { std::size_t{ 1 }, std::size_t{ 8 }, std::size_t{ 32 }, std::size_t{ 128 } }) {
+            OrderBook book(config);
+            std::uint64_t trades = 0;
+            auto countTrades = [&trades](const Trade&) { ++trades; };
+            const std::span<const Command> all(flow);
+
+            const auto start = Clock::now();
+            for (std::size_t offset = 0; offset < all.size(); offset += batchSize) {
+                processBatch(book, all.subspan(offset, std::min(batchSize, all.size() - offset)), countTrades);
+            }
+            const std::chrono::duration<double> elapsed = Clock::now() - start;
+
+            const double opsPerSec = static_cast<double>(flow.size()) / elapsed.count();
+            const bool matches = trades == referenceTrades && sameDepth(book.getBidDepth(kAllLevels), referenceBids)
+                && sameDepth(book.getAskDepth(kAllLevels), referenceAsks);
+            std::cout << indexName << " | batch " << batchSize << " | Ops/sec: " << opsPerSec
+                      << " | vs sequential: " << opsPerSec / sequentialOpsPerSec << "x"
+                      << " | Same book: " << (matches ? "yes" : "NO") << "\n";
+        }
+    }
+    std::cout << "\n";
+}
+
+// The single-symbol flow on one book, first with nothing published, then publishing a top-10
+// snapshot after every command that changed it while 0-4 reader threads spin on it. Readers
+// check every copy for tearing (levels out of order, crossed book) and, the first time they see
+// each snapshot, how long it had been out and how many commands the matcher had applied since.
+static void runTopOfBookBenchmark(std::uint64_t numOps) {
+    using Clock = std::chrono::steady_clock;
+    using Publisher = TopOfBookPublisher<10>;
+
+    std::vector<Command> flow;
+    flow.reserve(numOps);
+    for (const SymbolCommand& entry : generateMultiSymbolFlow(1, numOps, 0xC0FFEEULL)) {
+        flow.push_back(entry.command);
+    }
+    const OrderBookConfig config{ .ladderBase = 10000 - 512, .ladderTicks = 1024, .orderCapacity = 1 << 18, .idIndex = IdIndexKind::DENSE_WINDOW };
+
+    struct ReaderStats {
+        std::uint64_t reads = 0;
+        std::uint64_t retries = 0;
+        std::uint64_t torn = 0;
+        std::uint64_t snapshotsSeen = 0;
+        Histogram lagCommands;
+        Histogram ageNanos;
+    };
+
+    auto consistent = [](const Publisher::Snapshot& top) {
+        for (std::uint32_t i = 1; i < top.bidLevels; ++i) {
+            if (top.bids[i].price >= top.bids[i - 1].price) return false;
+        }
+        for (std::uint32_t i = 1; i < top.askLevels; ++i) {
+            if (top.asks[i].price <= top.asks[i - 1].price) return false;
+        }
+        return !top.spread() || *top.spread() > 0;
+    };
+
+    std::cout << "TOP-OF-BOOK PUBLICATION (" << flow.size() << " commands, seqlock, 10 levels, "
+              << std::thread::hardware_concurrency() << " hardware threads)\n";
+
+    double baselineOpsPerSec = 0.0;
+    for (const int readers : { -1, 0, 1, 2, 4 }) {
+        const bool publish = readers >= 0;
+        OrderBook book(config);
+        Publisher top;
+        std::uint64_t sequence = 0;
+        std::atomic<std::uint64_t> applied{ 0 };
+        std::atomic<bool> done{ false };
+        std::atomic<int> ready{ 0 };
+        if (publish) book.setLevelUpdateHandler([&](std::span<const LevelUpdate> updates) { top.publish(book, sequence, updates); });
+
+        std::vector<ReaderStats> stats(static_cast<std::size_t>(std::max(readers, 0)));
+        std::vector<std::thread> threads;
+        for (ReaderStats& mine : stats) {
+            threads.emplace_back([&, statsOut = &mine] {
+                ReaderStats local;
+                Publisher::Snapshot snapshot;
+                std::uint64_t lastSeen = 0;
+                ready.fetch_add(1);
+                while (!done.load(std::memory_order_relaxed)) {
+                    if (!top.tryRead(snapshot)) {
+                        ++local.retries;
+                        continue;
+                    }
+                    const std::uint64_t matcherAt = applied.load(std::memory_order_relaxed);
+                    const std::uint64_t nowTicks = latency_clock::now();
+                    ++local.reads;
+                    if (!consistent(snapshot)) ++local.torn;
+                    if (snapshot.sequence == lastSeen) continue;
+                    lastSeen = snapshot.sequence;
+                    ++local.snapshotsSeen;
+                    local.lagCommands.record(matcherAt > snapshot.sequence ? matcherAt - snapshot.sequence : 0);
+                    const std::uint64_t ageTicks = nowTicks > snapshot.publishedTicks ? nowTicks - snapshot.publishedTicks : 0;
+                    local.ageNanos.record(static_cast<std::uint64_t>(static_cast<double>(ageTicks) * latency_clock::nanosPerTick()));
+                }
+                *statsOut = local;
+            });
+        }
+        while (ready.load() < readers) std::this_thread::yield();
+
+        std::uint64_t trades = 0;
+        auto countTrades = [&trades](const Trade&) { ++trades; };
+        const auto start = Clock::now();
+        for (const Command& command : flow) {
+            ++sequence;
+            applyCommand(book, command, countTrades);
+            applied.store(sequence, std::memory_order_relaxed);
+        }
+        const std::chrono::duration<double> elapsed = Clock::now() - start;
+        done.store(true);
+        for (std::thread& thread : threads) thread.join();
+
+        const double opsPerSec = static_cast<double>(flow.size()) / elapsed.count();
+        if (!publish) {
+            baselineOpsPerSec = opsPerSec;
+            std::cout << "no publishing | Ops/sec: " << opsPerSec << "\n";
+            continue;
+        }
+
+        const Publisher::Snapshot last = top.read();
+        const std::vector<OrderBook::BookLevel> bids = book.getBidDepth(10);
+        const std::vector<OrderBook::BookLevel> asks = book.getAskDepth(10);
+        bool matches = last.bidLevels == bids.size() && last.askLevels == asks.size() && last.sequence <= sequence;
+        for (std::size_t i = 0; matches && i < bids.size(); ++i) {
+            matches = last.bids[i].price == bids[i].price && last.bids[i].volume == bids[i].volume;
+        }
+        for (std::size_t i = 0; matches && i < asks.size(); ++i) {
+            matches = last.asks[i].price == asks[i].price && last.asks[i].volume == asks[i].volume;
+        }
+
+        ReaderStats total;
+        for (const ReaderStats& reader : stats) {
+            total.reads += reader.reads;
+            total.retries += reader.retries;
+            total.torn += reader.torn;
+            total.snapshotsSeen += reader.snapshotsSeen;
+            total.lagCommands.merge(reader.lagCommands);
+            total.ageNanos.merge(reader.ageNanos);
+        }
+
+        std::cout << "publishing, " << readers << " reader" << (readers == 1 ? "" : "s")
+                  << " | Ops/sec: " << opsPerSec << " | vs no publishing: " << opsPerSec / baselineOpsPerSec << "x"
+                  << " | Final snapshot current: " << (matches ? "yes" : "NO");
+        if (readers > 0) {
+            std::cout << "\n    reads/sec " << static_cast<double>(total.reads) / elapsed.count()
+                      << " | retried " << 100.0 * static_cast<double>(total.retries) / static_cast<double>(std::max<std::uint64_t>(total.reads + total.retries, 1)) << "%"
+                      << " | torn " << total.torn
+                      << "\n    snapshots seen per reader " << total.snapshotsSeen / static_cast<std::uint64_t>(readers) << " of " << top.version()
+                      << " | lag commands p50/p99/max " << total.lagCommands.percentile(0.50) << "/" << total.lagCommands.percentile(0.99)
+                      << "/" << total.lagCommands.max()
+                      << " | age ns p50/p99 " << total.ageNanos.percentile(0.50) << "/" << total.ageNanos.percentile(0.99);
+        }
+        std::cout << "\n";
+    }
+    std::cout << "\n";
+}
+
+// Book shapes for the policy study, each fixing one more piece of DefaultBookPolicy at compile time.
+struct HashIdPolicy : DefaultBookPolicy {
+    template <typename Value>
+    using IdIndex = FlatHashIndex<Value>;
+};
+
+struct DenseIdPolicy : DefaultBookPolicy {
+    template <typename Value>
+    using IdIndex = DenseIdIndex<Value>;
+};
+
+struct GtcLimitPolicy : DenseIdPolicy {
+    static constexpr bool kMarketOrders = false;
+    static constexpr bool kImmediateOrCancel = false;
+    static constexpr bool kFillOrKill = false;
+};
+
+struct MapLevelPolicy : DenseIdPolicy {
+    template <typename Level, bool Descending>
+    using Levels = MapLadder<Price, Level, Descending>;
+};
+
+struct StatsPolicy : DenseIdPolicy {
+    static constexpr bool kStats = true;
+};
+
+struct SoaLevelPolicy : DenseIdPolicy {
+    using LevelQueue = SoaPriceLevel;
+};
+
+struct PolicyRun {
+    double opsPerSec = 0.0;
+    std::uint64_t trades = 0;
+    std::vector<OrderBook::BookLevel> bids;
+    std::vector<OrderBook::BookLevel> asks;
+};
+
+// Ids at the ends of the range (the all-ones id is FlatHashIndex's empty-slot marker) rest,
+// duplicate, cancel and go unknown like any other.
+template <typename Policy>
+static bool handlesEdgeIds(const OrderBookConfig& config) {
+    BasicOrderBook<Policy> book(config);
+    auto ignore = [](const Trade&) {};
+    for (const OrderId id : { OrderId{ 0 }, OrderId{ UINT64_MAX } }) {
+        Order order(id, Side::BUY, OrderType::LIMIT, 10000, 5, TimeInForce::GTC);
+        Order duplicate = order;
+        if (book.cancelOrder(id).reject != RejectReason::UNKNOWN_ID) return false;
+        if (!book.addOrder(order, ignore).resting) return false;
+        if (book.addOrder(duplicate, ignore).reject != RejectReason::DUPLICATE_ID) return false;
+        if (!book.cancelOrder(id).accepted()) return false;
+        if (book.modifyOrder(OrderModify{ id, 10000, 5 }, ignore).reject != RejectReason::UNKNOWN_ID) return false;
+    }
+    return book.getBidDepth(kAllLevels).empty();
+}
+
+template <typename Policy>
+static PolicyRun runPolicyFlow(const OrderBookConfig& config, const std::vector<Command>& flow) {
+    using Clock = std::chrono::steady_clock;
+
+    BasicOrderBook<Policy> book(config);
+    PolicyRun run;
+    auto countTrades = [&run](const Trade&) { ++run.trades; };
+    const auto start = Clock::now();
+    for (const Command& command : flow) applyCommand(book, command, countTrades);
+    const std::chrono::duration<double> elapsed = Clock::now() - start;
+
+    run.opsPerSec = static_cast<double>(flow.size()) / elapsed.count();
+    run.bids = book.getBidDepth(kAllLevels);
+    run.asks = book.getAskDepth(kAllLevels);
+    return run;
+}
+
+// The single-symbol flow with its market orders dropped, so every policy (GTC-limit-only
+// included) can take it, on the default OrderBook and on books with one policy fixed at
+// compile time. Rounds are interleaved and each row keeps its best round.
+static void runPolicyBenchmark(std::uint64_t numOps) {
+    std::vector<Command> flow;
+    flow.reserve(numOps);
+    for (const SymbolCommand& entry : generateMultiSymbolFlow(1, numOps, 0xC0FFEEULL)) {
+        if (entry.command.type != CommandType::ADD || entry.command.orderType == OrderType::LIMIT) flow.push_back(entry.command);
+    }
+
+    const OrderBookConfig hashConfig{ .ladderBase = 10000 - 512, .ladderTicks = 1024, .orderCapacity = 1 << 18 };
+    OrderBookConfig denseConfig = hashConfig;
+    denseConfig.idIndex = IdIndexKind::DENSE_WINDOW;
+
+    struct Row {
+        const char* label;
+        std::function<PolicyRun()> run;
+        PolicyRun best;
+        bool edgeIds = false;
+    };
+    std::vector<Row> rows = {
+        { "OrderBook, hash ids from config", [&] { return runPolicyFlow<DefaultBookPolicy>(hashConfig, flow); }, {}, handlesEdgeIds<DefaultBookPolicy>(hashConfig) },
+        { "OrderBook, dense ids from config", [&] { return runPolicyFlow<DefaultBookPolicy>(denseConfig, flow); }, {}, handlesEdgeIds<DefaultBookPolicy>(denseConfig) },
+        { "FlatHashIndex fixed", [&] { return runPolicyFlow<HashIdPolicy>(hashConfig, flow); }, {}, handlesEdgeIds<HashIdPolicy>(hashConfig) },
+        { "DenseIdIndex fixed", [&] { return runPolicyFlow<DenseIdPolicy>(denseConfig, flow); }, {}, handlesEdgeIds<DenseIdPolicy>(denseConfig) },
+        { "dense ids, GTC limits only", [&] { return runPolicyFlow<GtcLimitPolicy>(denseConfig, flow); }, {}, handlesEdgeIds<GtcLimitPolicy>(denseConfig) },
+        { "dense ids, MapLadder levels", [&] { return runPolicyFlow<MapLevelPolicy>(denseConfig, flow); }, {}, handlesEdgeIds<MapLevelPolicy>(denseConfig) },
+        { "dense ids, stats on", [&] { return runPolicyFlow<StatsPolicy>(denseConfig, flow); }, {}, handlesEdgeIds<StatsPolicy>(denseConfig) },
+        { "dense ids, SoA levels", [&] { return runPolicyFlow<SoaLevelPolicy>(denseConfig, flow); }, {}, handlesEdgeIds<SoaLevelPolicy>(denseConfig) },
+    };
+
+    constexpr int kRounds = 3;
+    for (int round = 0; round < kRounds; ++round) {
+        for (Row& row : rows) {
+            PolicyRun run = row.run();
+            if (run.opsPerSec > row.best.opsPerSec) row.best = std::move(run);
+        }
+    }
+
+    std::cout << "BOOK POLICIES (" << flow.size() << " commands, best of " << kRounds << ")\n";
+    const PolicyRun& reference = rows.front().best;
+    for (const Row& row : rows) {
+        const bool matches = row.best.trades == reference.trades && sameDepth(row.best.bids, reference.bids)
+            && sameDepth(row.best.asks, reference.asks);
+        std::cout << row.label << " | Ops/sec: " << row.best.opsPerSec
+                  << " | vs OrderBook: " << row.best.opsPerSec / reference.opsPerSec << "x"
+                  << " | Same book: " << (matches ? "yes" : "NO") << " | Edge ids: " << (row.edgeIds ? "ok" : "NO") << "\n";
+    }
+    std::cout << "\n";
+}
+
+struct StopFreePolicy : DefaultBookPolicy {
+    static constexpr bool kStopOrders = false;
+};
+
+// Stop-limit orders the single-symbol flow never reaches: buys above its asks and sells below
+// its bids, spread over 2000 trigger prices a side.
+static std::vector<Order> makeIdleStops(std::size_t count, OrderId firstId) {
+    std::vector<Order> stops;
+    stops.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        const Price offset = static_cast<Price>(i / 2 % 2000);
+        const OrderId id = firstId + i;
+        if (i % 2 == 0) stops.emplace_back(id, Side::BUY, OrderType::STOP_LIMIT, 10500 + offset, 10, TimeInForce::GTC, 10400 + offset);
+        else stops.emplace_back(id, Side::SELL, OrderType::STOP_LIMIT, 9500 - offset, 10, TimeInForce::GTC, 9600 - offset);
+    }
+    return stops;
+}
+
+// Resting limits just as far out of reach (buys below the bids, sells above the asks), so the
+// book and its id index carry the same number of idle orders without any stops.
+static std::vector<Order> makeIdleLimits(std::size_t count, OrderId firstId) {
+    std::vector<Order> limits;
+    limits.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        const Price offset = static_cast<Price>(i / 2 % 2000);
+        const Side side = i % 2 == 0 ? Side::BUY : Side::SELL;
+        limits.emplace_back(firstId + i, side, OrderType::LIMIT, side == Side::BUY ? 9600 - offset : 10400 + offset, 10, TimeInForce::GTC);
+    }
+    return limits;
+}
+
+struct StopRun {
+    double nanosPerCommand = 0.0;
+    std::uint64_t commands = 0;
+    std::uint64_t trades = 0;
+    std::uint64_t fired = 0;
+};
+
+// Adds the idle orders to an empty book (there is no last trade yet, so stops all wait), then
+// times the flow.
+template <typename Policy>
+static StopRun runStopFlow(const OrderBookConfig& config, std::span<const Command> flow, const std::vector<Order>& idle) {
+    using Clock = std::chrono::steady_clock;
+
+    BasicOrderBook<Policy> book(config);
+    for (Order order : idle) book.addOrder(order, [](const Trade&) {});
+    const std::size_t stops = book.getPendingStopCount();
+
+    StopRun run;
+    auto countTrades = [&run](const Trade&) { ++run.trades; };
+    const auto start = Clock::now();
+    for (const Command& command : flow) applyCommand(book, command, countTrades);
+    const std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+
+    run.commands = flow.size();
+    run.nanosPerCommand = elapsed.count() / static_cast<double>(flow.size());
+    run.fired = stops - book.getPendingStopCount();
+    return run;
+}
+
+// Stops kept outside the book, as before: every command that traded re-checks each pending
+// stop against the range of prices it traded at.
+static StopRun runRescanFlow(const OrderBookConfig& config, std::span<const Command> flow, const std::vector<Order>& stops) {
+    using Clock = std::chrono::steady_clock;
+
+    BasicOrderBook<StopFreePolicy> book(config);
+    std::vector<Order> pending = stops;
+    StopRun run;
+    Price low = 0;
+    Price high = 0;
+    bool traded = false;
+    auto track = [&](const Trade& trade) {
+        ++run.trades;
+        low = traded ? std::min(low, trade.price) : trade.price;
+        high = traded ? std::max(high, trade.price) : trade.price;
+        traded = true;
+    };
+
+    const auto start = Clock::now();
+    for (const Command& command : flow) {
+        traded = false;
+        applyCommand(book, command, track);
+        if (!traded) continue;
+        for (const Order& stop : pending) {
+            if (stop.side == Side::BUY ? high >= stop.stopPrice : low <= stop.stopPrice) ++run.fired;
+        }
+    }
+    const std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+
+    run.commands = flow.size();
+    run.nanosPerCommand = elapsed.count() / static_cast<double>(flow.size());
+    return run;
+}
+
+// The single-symbol flow against 0 to 100k pending stops that never fire, to show what the
+// trigger check adds per trade as the stop count grows. Reference rows: a book built without
+// stop support, the same book holding 100k idle resting limits instead (what 100k more live
+// ids cost whatever they are), and stops re-scanned outside the book after every trading
+// command, on a shorter prefix of the flow. Rounds are interleaved and each row keeps its best.
+static void runStopBenchmark(std::uint64_t numOps) {
+    std::vector<Command> flow;
+    flow.reserve(numOps);
+    for (const SymbolCommand& entry : generateMultiSymbolFlow(1, numOps, 0xC0FFEEULL)) flow.push_back(entry.command);
+    const std::span<const Command> rescanFlow(flow.data(), std::min<std::size_t>(flow.size(), 50'000));
+
+    // Hash ids: the stops' ids sit above the flow's and would push a dense window past them.
+    const OrderBookConfig config{ .ladderBase = 10000 - 512, .ladderTicks = 1024, .orderCapacity = 1 << 18 };
+    const OrderId firstStopId = numOps + 1;
+    const std::vector<Order> stops1k = makeIdleStops(1'000, firstStopId);
+    const std::vector<Order> stops10k = makeIdleStops(10'000, firstStopId);
+    const std::vector<Order> stops100k = makeIdleStops(100'000, firstStopId);
+    const std::vector<Order> limits100k = makeIdleLimits(100'000, firstStopId);
+
+    struct Row {
+        const char* label;
+        std::function<StopRun()> run;
+        StopRun best;
+    };
+    std::vector<Row> rows = {
+        { "stops compiled out", [&] { return runStopFlow<StopFreePolicy>(config, flow, {}); }, {} },
+        { "0 pending stops", [&] { return runStopFlow<DefaultBookPolicy>(config, flow, {}); }, {} },
+        { "1k pending stops", [&] { return runStopFlow<DefaultBookPolicy>(config, flow, stops1k); }, {} },
+        { "10k pending stops", [&] { return runStopFlow<DefaultBookPolicy>(config, flow, stops10k); }, {} },
+        { "100k pending stops", [&] { return runStopFlow<DefaultBookPolicy>(config, flow, stops100k); }, {} },
+        { "stops compiled out, 100k idle limits", [&] { return runStopFlow<StopFreePolicy>(config, flow, limits100k); }, {} },
+        { "100k stops rescanned outside", [&] { return runRescanFlow(config, rescanFlow, stops100k); }, {} },
+    };
+
+    constexpr int kRounds = 5;
+    for (int round = 0; round < kRounds; ++round) {
+        for (Row& row : rows) {
+            const StopRun run = row.run();
+            if (row.best.commands == 0 || run.nanosPerCommand < row.best.nanosPerCommand) row.best = run;
+        }
+    }
+
+    std::cout << "STOP ORDERS (" << flow.size() << " commands, best of " << kRounds << ")\n";
+    const StopRun& reference = rows.front().best;
+    for (const Row& row : rows) {
+        const double tradesPerCommand = static_cast<double>(row.best.trades) / static_cast<double>(row.best.commands);
+        std::cout << row.label << " | ns/command: " << row.best.nanosPerCommand
+                  << " | trades/command: " << tradesPerCommand
+                  << " | ns/trade vs compiled out: " << (row.best.nanosPerCommand - reference.nanosPerCommand) / tradesPerCommand
+                  << " | stops fired: " << row.best.fired << "\n";
+    }
+    std::cout << "\n";
+}
+
+// Order as it was laid out before the one-byte enums and the stored remaining quantity.
+struct WideOrder {
+    OrderId id;
+    Side side;
+    OrderType type;
+    Price price;
+    Quantity quantity;
+    Quantity filledQuantity;
+    TimeInForce tif;
+    Price stopPrice;
+};
+
+// Fills a pool with 4 * count orders, releases three in four at random and takes count back,
+// so consecutive queue entries land on scattered nodes as they do in a long-running book.
+static std::vector<OrderHandle> scatterOrders(OrderPool& pool, std::size_t count, std::mt19937_64& rng) {
+    std::vector<OrderHandle> handles;
+    for (std::size_t i = 0; i < 4 * count; ++i) {
+        handles.push_back(pool.acquire(static_cast<OrderId>(i + 1), Side::BUY, OrderType::LIMIT, Price{ 10000 }, Quantity{ 1 }, TimeInForce::GTC));
+    }
+    std::shuffle(handles.begin(), handles.end(), rng);
+    for (std::size_t i = count; i < handles.size(); ++i) pool.release(handles[i]);
+    handles.resize(count);
+
+    std::uniform_int_distribution<Quantity> quantity(1, 100);
+    for (OrderHandle handle : handles) {
+        Order& order = pool[handle];
+        order.quantity = order.remainingQuantity = quantity(rng);
+    }
+    return handles;
+}
+
+// Nanoseconds per order for repeats calls of pass over a level of count orders; the results
+// are summed into sink so none of the passes can be dropped.
+template <typename Pass>
+static double nanosPerOrder(std::size_t count, std::size_t repeats, std::uint64_t& sink, Pass&& pass) {
+    using Clock = std::chrono::steady_clock;
+    const auto start = Clock::now();
+    for (std::size_t i = 0; i < repeats; ++i) sink += pass();
+    const std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+    return elapsed.count() / static_cast<double>(repeats * count);
+}
+
+// Bytes per resting order under the old and packed Order layouts and with SoaPriceLevel's
+// arrays added, then the cost per order of totalling a level and of finding where a fill of
+// half its volume stops: by walking PriceLevel's links, and over SoaPriceLevel's quantity
+// array with the scalar and AVX2 kernels. The last row queues the level and matches it out
+// completely through each queue. Levels of 8, 64 and 512 orders on scattered pool nodes.
+static void runLevelLayoutBenchmark() {
+    constexpr std::size_t kLinkBytes = 2 * sizeof(OrderHandle);
+    std::cout << "LEVEL LAYOUT\n"
+              << "Order bytes: " << sizeof(WideOrder) << " before, " << sizeof(Order) << " packed"
+              << " | pool node: " << sizeof(WideOrder) + kLinkBytes << " before, " << sizeof(Order) + kLinkBytes << " packed"
+              << " | SoA queue arrays: " << sizeof(Quantity) + sizeof(OrderHandle) << " more per order\n"
+              << "AVX2: " << (cpuHasAvx2() ? "yes" : "no") << "\n";
+
+    std::mt19937_64 rng(0x1E7E1ULL);
+    std::uint64_t sink = 0;
+    for (const std::size_t count : { std::size_t{ 8 }, std::size_t{ 64 }, std::size_t{ 512 } }) {
+        const std::size_t repeats = (std::size_t{ 1 } << 22) / count;
+
+        OrderPool listPool;
+        OrderPool soaPool;
+        const std::vector<OrderHandle> listHandles = scatterOrders(listPool, count, rng);
+        const std::vector<OrderHandle> soaHandles = scatterOrders(soaPool, count, rng);
+        PriceLevel list;
+        SoaPriceLevel soa;
+        std::vector<Quantity> quantities;
+        for (OrderHandle handle : listHandles) list.addOrder(listPool, handle);
+        for (OrderHandle handle : soaHandles) {
+            soa.addOrder(soaPool, handle);
+            quantities.push_back(soaPool[handle].getRemainingQuantity());
+        }
+        const Quantity half = list.getTotalVolume() / 2;
+        // Read back on every pass so the compiler can't hoist a kernel call out of the loop.
+        const Quantity* volatile data = quantities.data();
+
+        const double listSum = nanosPerOrder(count, repeats, sink, [&] { return list.recomputeTotalVolume(listPool); });
+        const double scalarSum = nanosPerOrder(count, repeats, sink, [&] { return sumQuantitiesScalar(data, count); });
+        const double listCut = nanosPerOrder(count, repeats, sink, [&] {
+            Quantity before = 0;
+            std::uint64_t index = 0;
+            for (OrderHandle handle = list.front(); handle != kInvalidHandle; handle = listPool.next(handle), ++index) {
+                before += listPool[handle].getRemainingQuantity();
+                if (before >= half) break;
+            }
+            return index;
+        });
+        const double scalarCut = nanosPerOrder(count, repeats, sink, [&] { return findFillCutScalar(data, count, half).index; });
+        double avx2Sum = 0.0;
+        double avx2Cut = 0.0;
+#if ORDERBOOK_AVX2_KERNELS
+        if (cpuHasAvx2()) {
+            avx2Sum = nanosPerOrder(count, repeats, sink, [&] { return sumQuantitiesAvx2(data, count); });
+            avx2Cut = nanosPerOrder(count, repeats, sink, [&] { return findFillCutAvx2(data, count, half).index; });
+        }
+#endif
+
+        // Queue every order, match the level out and put the quantities back for the next pass.
+        auto matchOut = [count](auto& level, OrderPool& pool, const std::vector<OrderHandle>& handles) {
+            Quantity total = 0;
+            for (OrderHandle handle : handles) {
+                Order& order = pool[handle];
+                order.remainingQuantity = order.quantity;
+                total += order.quantity;
+                level.addOrder(pool, handle);
+            }
+            std::uint64_t fills = 0;
+            level.match(pool, total, [&fills](OrderHandle, const Order&, Quantity) { ++fills; });
+            return fills == count ? total : 0;
+        };
+        list.match(listPool, list.getTotalVolume(), [](OrderHandle, const Order&, Quantity) {});
+        soa.match(soaPool, soa.getTotalVolume(), [](OrderHandle, const Order&, Quantity) {});
+        const double listMatch = nanosPerOrder(count, repeats / 4, sink, [&] { return matchOut(list, listPool, listHandles); });
+        const double soaMatch = nanosPerOrder(count, repeats / 4, sink, [&] { return matchOut(soa, soaPool, soaHandles); });
+
+        std::cout << count << " orders | total ns/order: list " << listSum << ", SoA scalar " << scalarSum << ", SoA AVX2 " << avx2Sum
+                  << " | fill cut ns/order: list " << listCut << ", SoA scalar " << scalarCut << ", SoA AVX2 " << avx2Cut
+                  << " | queue + match out ns/order: list " << listMatch << ", SoA " << soaMatch << "\n";
+    }
+    std::cout << "(checksum " << sink << ")\n\n";
+}
+
+// Where levels live and how ids are looked up; the suite can run each profile on any of them.
+enum class Backend { MAP, LADDER, DENSE_IDS };
+
+static const char* backendName(Backend backend) {
+    switch (backend) {
+    case Backend::MAP: return "map";
+    case Backend::LADDER: return "ladder";
+    case Backend::DENSE_IDS: return "dense";
+    }
+    return "?";
+}
+
+// The dense band is sized to every price the profile can generate (at least +/-512 ticks).
+static OrderBookConfig configFor(Backend backend, const WorkloadProfile& profile) {
+    OrderBookConfig config{ .orderCapacity = 1 << 18 };
+    if (backend == Backend::MAP) return config;
+
+    const Price reach = std::max({ profile.spreadHalf + profile.bandWidth, profile.modifyRange, Price{ 512 } });
+    const Price halfBand = static_cast<Price>(std::bit_ceil(static_cast<std::uint64_t>(reach)));
+    config.ladderBase = profile.centerPrice - halfBand;
+    config.ladderTicks = static_cast<std::size_t>(2 * halfBand);
+    if (backend == Backend::DENSE_IDS) config.idIndex = IdIndexKind::DENSE_WINDOW;
+    return config;
+}
+
+// Map vs ladder vs dense ids on the default workload.
+static void runBackendStudy() {
+    const WorkloadProfile profile;
+    const BenchmarkResult mapResult = runBenchmark(configFor(Backend::MAP, profile), profile);
+    printResult("std::map levels, flat hash ids", mapResult);
+
+    const BenchmarkResult ladderResult = runBenchmark(configFor(Backend::LADDER, profile), profile);
+    printResult("dense tick ladder, flat hash ids", ladderResult);
+
+    const BenchmarkResult denseIdResult = runBenchmark(configFor(Backend::DENSE_IDS, profile), profile);
+    printResult("dense tick ladder, dense id window", denseIdResult);
+
+    if (ladderResult.seconds > 0.0) {
+        std::cout << "Ladder speedup vs map: " << (mapResult.seconds / ladderResult.seconds) << "x\n\n";
+    }
+}
+
+// Amend-heavy flow: most modifies shrink size at the resting price.
+static void runAmendStudy() {
+    WorkloadProfile amendProfile;
+    amendProfile.name = "modify-heavy";
+    amendProfile.addPct = 40;
+    amendProfile.cancelPct = 10;
+    amendProfile.modifyPct = 50;
+    amendProfile.amendPct = 80;
+    WorkloadProfile replaceProfile = amendProfile;
+    replaceProfile.amendByReplace = true;
+
+    const OrderBookConfig config = configFor(Backend::DENSE_IDS, amendProfile);
+    const BenchmarkResult replaceResult = runBenchmark(config, replaceProfile);
+    printResult("modify-heavy, amend as cancel + add", replaceResult);
+
+    const BenchmarkResult amendResult = runBenchmark(config, amendProfile);
+    printResult("modify-heavy, in-place modifyOrder", amendResult);
+
+    if (amendResult.modifies > 0 && replaceResult.modifies > 0 && amendResult.modifyNanos > 0.0) {
+        std::cout << "In-place modify speedup: "
+                  << ((replaceResult.modifyNanos / replaceResult.modifies) / (amendResult.modifyNanos / amendResult.modifies))
+                  << "x per modify\n\n";
+    }
+}
+
+// Market-data consumer wanting the top 10 levels after every command: rebuild it from
+// getBidDepth/getAskDepth, or keep a mirror from the incremental level feed.
+static void runDepthStudy() {
+    WorkloadProfile pollProfile;
+    pollProfile.name = "depth-poll";
+    pollProfile.numOps = 2'000'000ULL;
+    pollProfile.depthConsumer = DepthConsumer::POLL_DEPTH;
+    WorkloadProfile mirrorProfile = pollProfile;
+    mirrorProfile.name = "depth-mirror";
+    mirrorProfile.depthConsumer = DepthConsumer::MIRROR;
+
+    const OrderBookConfig config = configFor(Backend::DENSE_IDS, pollProfile);
+    const BenchmarkResult pollResult = runBenchmark(config, pollProfile);
+    printResult("2M ops, polling top-10 depth per command", pollResult);
+
+    const BenchmarkResult mirrorResult = runBenchmark(config, mirrorProfile);
+    printResult("2M ops, incremental L2 mirror", mirrorResult);
+
+    if (mirrorResult.depthNanos > 0.0) {
+        std::cout << "Mirror vs polling consumer cost: " << (pollResult.depthNanos / mirrorResult.depthNanos) << "x cheaper\n\n";
+    }
+}
+
+// What a feed reader thread saw, for checking against the book it followed.
+struct FeedFollow {
+    FeedBook book;
+    std::uint64_t lost = 0;
+    Histogram latencyNanos;
+};
+
+// Reads the ring from its oldest record until the writer closes it, yielding when it is
+// empty. Latency is sampled on every 16th record to keep clock reads off the reader's path.
+static void followFeed(MarketDataReader& reader, FeedFollow& out) {
+    const double nanosPerTick = latency_clock::nanosPerTick();
+    MarketDataRecord record;
+    for (;;) {
+        const MarketDataRead status = reader.poll(record);
+        if (status == MarketDataRead::RECORD) {
+            out.book.apply(record);
+            if (record.sequence % 16 != 0) continue;
+            const std::uint64_t now = latency_clock::now();
+            if (now > record.publishedTicks) out.latencyNanos.record(static_cast<std::uint64_t>(static_cast<double>(now - record.publishedTicks) * nanosPerTick));
+        } else if (status == MarketDataRead::EMPTY) {
+            if (reader.isFinished()) break;
+            std::this_thread::yield();
+        }
+    }
+    out.lost = reader.getLost();
+}
+
+// Shared-memory market data ring: raw publication rate into it, then the default workload
+// (numOps measured) with no feed, with the book publishing to a ring nobody reads (with and
+// without per-command timestamps), and with a reader thread rebuilding the book from it. The reader runs in this process for the
+// benchmark, but maps the ring by name exactly as another process would. Rounds are
+// interleaved and each row keeps its best.
+static void runFeedBenchmark(std::uint64_t numOps) {
+    using Clock = std::chrono::steady_clock;
+    const std::string name = "/orderbook-bench-" + std::to_string(::getpid());
+    constexpr std::size_t kCapacity = std::size_t{ 1 } << 20;
+
+    std::cout << "MARKET DATA RING (" << sizeof(MarketDataRecord) << "-byte records in " << kCapacity << " 64-byte slots)\n";
+    {
+        // Batches of four, about one command's worth.
+        constexpr std::uint64_t kRecords = 32'000'000ULL;
+        MarketDataPublisher feed(name, kCapacity);
+        std::array<LevelUpdate, 4> batch{};
+        for (std::size_t i = 0; i < batch.size(); ++i) batch[i] = LevelUpdate{ 10000 + static_cast<Price>(i), 100, Side::BUY, LevelAction::CHANGE };
+        const auto start = Clock::now();
+        for (std::uint64_t i = 0; i < kRecords; i += batch.size()) {
+            batch[0].volume = i;
+            feed.publish(std::span<const LevelUpdate>(batch));
+        }
+        const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        std::cout << "Raw publish, no readers | Records/sec: " << static_cast<double>(kRecords) / seconds
+                  << " | ns/record: " << seconds * 1e9 / static_cast<double>(kRecords)
+                  << " | MB/sec: " << static_cast<double>(kRecords) * sizeof(market_data_detail::Slot) / seconds / 1e6 << "\n";
+    }
+
+    WorkloadProfile profile;
+    profile.numOps = numOps;
+    const OrderBookConfig config = configFor(Backend::DENSE_IDS, profile);
+
+    constexpr int kRounds = 3;
+    BenchmarkResult plain;
+    BenchmarkResult published;
+    BenchmarkResult unstamped;
+    BenchmarkResult followed;
+    FeedFollow follow;
+    for (int round = 0; round < kRounds; ++round) {
+        BenchmarkResult run = runBenchmark(config, profile);
+        if (run.opsPerSec() > plain.opsPerSec()) plain = std::move(run);
+
+        {
+            MarketDataPublisher feed(name, kCapacity);
+            WorkloadProfile feedProfile = profile;
+            feedProfile.feed = &feed;
+            run = runBenchmark(config, feedProfile);
+            if (run.opsPerSec() > published.opsPerSec()) published = std::move(run);
+        }
+
+        {
+            MarketDataPublisher feed(name, kCapacity, false);
+            WorkloadProfile feedProfile = profile;
+            feedProfile.feed = &feed;
+            run = runBenchmark(config, feedProfile);
+            if (run.opsPerSec() > unstamped.opsPerSec()) unstamped = std::move(run);
+        }
+
+        {
+            MarketDataPublisher feed(name, kCapacity);
+            MarketDataReader reader(name, MarketDataReader::Start::OLDEST);
+            auto current = std::make_unique<FeedFollow>();
+            std::thread readerThread([&] { followFeed(reader, *current); });
+            WorkloadProfile feedProfile = profile;
+            feedProfile.feed = &feed;
+            run = runBenchmark(config, feedProfile);
+            feed.close();
+            readerThread.join();
+            if (run.opsPerSec() > followed.opsPerSec()) {
+                followed = std::move(run);
+                follow = std::move(*current);
+            }
+        }
+    }
+
+    auto row = [&](const char* label, const BenchmarkResult& result) {
+        std::cout << label << " | Ops/sec: " << result.opsPerSec() << " | vs no feed: " << result.opsPerSec() / plain.opsPerSec() << "x";
+        if (result.feedRecords > 0) {
+            std::cout << " | Records/op: " << static_cast<double>(result.feedRecords) / static_cast<double>(result.ops)
+                      << " | Records/sec: " << static_cast<double>(result.feedRecords) / result.seconds;
+        }
+        std::cout << "\n";
+    };
+    std::cout << "Default workload, " << numOps << " ops, best of " << kRounds << " (" << std::thread::hardware_concurrency() << " hardware threads)\n";
+    row("no feed", plain);
+    row("publishing, no reader", published);
+    row("publishing without timestamps, no reader", unstamped);
+    row("publishing, reader thread rebuilding the book", followed);
+
+    const bool rebuilt = follow.lost == 0 && follow.book.getOrderCount() == followed.finalRestingOrders
+        && sameDepth(follow.book.getBidDepth(kAllLevels), followed.finalBids) && sameDepth(follow.book.getAskDepth(kAllLevels), followed.finalAsks)
+        && follow.book.matchesLevels();
+    std::cout << "Reader: " << follow.book.getRecordCount() << " records, " << follow.lost << " lost | Publish-to-read ns p50/p99: "
+              << follow.latencyNanos.percentile(0.50) << "/" << follow.latencyNanos.percentile(0.99)
+              << " | Rebuilt book matches: " << (rebuilt ? "yes" : "NO") << "\n\n";
+}
+
+struct AnalyticsPolicy : DefaultBookPolicy {
+    using Analytics = TradeAnalytics;
+};
+
+// Default workload with and without the trade analytics stage in the match loop, bars cut on
+// the op index. Rounds are interleaved and each side keeps its best.
+static void runAnalyticsStudy() {
+    const WorkloadProfile profile;
+    const OrderBookConfig config = configFor(Backend::DENSE_IDS, profile);
+
+    constexpr int kRounds = 3;
+    BenchmarkResult plain;
+    BenchmarkResult withAnalytics;
+    for (int round = 0; round < kRounds; ++round) {
+        BenchmarkResult run = runBenchmark(config, profile);
+        if (run.opsPerSec() > plain.opsPerSec()) plain = std::move(run);
+        run = runBenchmark<BasicOrderBook<AnalyticsPolicy>>(config, profile);
+        if (run.opsPerSec() > withAnalytics.opsPerSec()) withAnalytics = std::move(run);
+    }
+
+    printResult("default workload, no analytics (best of 3)", plain);
+    printResult("default workload, TradeAnalytics (best of 3)", withAnalytics);
+    std::cout << "Analytics: " << withAnalytics.analyticsTrades << " trades, volume " << withAnalytics.analyticsVolume
+              << ", VWAP " << withAnalytics.analyticsVwap.value_or(0.0) << ", " << withAnalytics.analyticsBars << " bars of "
+              << kAnalyticsBarOps << " ops | Trade count matches sink: "
+              << (withAnalytics.analyticsTrades == withAnalytics.trades ? "yes" : "NO") << "\n";
+    if (withAnalytics.opsPerSec() > 0.0) {
+        std::cout << "Analytics overhead: " << (plain.opsPerSec() / withAnalytics.opsPerSec() - 1.0) * 100.0 << "%\n\n";
+    }
+}
+
+struct Study {
+    const char* name;
+    const char* description;
+    std::function<void()> run;
+};
+
+static std::vector<Study> studies() {
+    const WorkloadProfile defaults;
+    return {
+        { "backends", "default workload on map / ladder / dense-id books", runBackendStudy },
+        { "amend", "in-place modifyOrder vs cancel + add amends", runAmendStudy },
+        { "depth", "polled depth vs incremental L2 mirror", runDepthStudy },
+        { "engine", "sharded multi-symbol engine scaling", [] { runEngineBenchmark(64, 2'000'000ULL); } },
+        { "pipeline", "decode -> match -> publish pipeline vs direct calls", [] { runPipelineBenchmark(2'000'000ULL); } },
+        { "journal", "journal the default workload and replay it", [defaults] { runJournalReplayBenchmark(configFor(Backend::DENSE_IDS, defaults)); } },
+        { "snapshot", "snapshot and restore a 1M-order book", [defaults] { runSnapshotBenchmark(configFor(Backend::LADDER, defaults), 1'000'000); } },
+        { "mass-cancel", "cancelAll / cancelSide / cancelPriceRange vs cancelOrder per id on a 1M-order book", [] { runMassCancelBenchmark(1'000'000); } },
+        { "batch", "processBatch with prefetching at batch sizes 1/8/32/128 vs one call per command", [] { runBatchBenchmark(4'000'000ULL); } },
+        { "top-of-book", "seqlock top-10 publication: matcher cost and reader staleness with 0-4 reader threads", [] { runTopOfBookBenchmark(4'000'000ULL); } },
+        { "stops", "trigger-book cost per trade with 0 to 100k pending stops vs rescanning them", [] { runStopBenchmark(2'000'000ULL); } },
+        { "level-layout", "Order size and level scans: linked PriceLevel vs SoA quantity arrays, scalar and AVX2", runLevelLayoutBenchmark },
+        { "feed", "shared-memory market data ring: publish rate and matcher overhead with and without a reader", [] { runFeedBenchmark(2'000'000ULL); } },
+        { "analytics", "default workload with and without streaming VWAP / volume / OHLCV bars in the match loop", runAnalyticsStudy },
+        { "policies", "default OrderBook vs compile-time id index / order kind / level / stats policies", [] { runPolicyBenchmark(2'000'000ULL); } },
+    };
+}
+
+struct TrialRecord {
+    WorkloadProfile profile;
+    Backend backend;
+    unsigned trial;
+    BenchmarkResult result;
+};
+
+static std::string jsonString(const std::string& text) {
+    std::string quoted = "\"";
+    for (const char c : text) {
+        if (c == '"' || c == '\\') quoted += '\\';
+        quoted += c;
+    }
+    return quoted + "\"";
+}
+
+
+// One flat row per trial; the JSON and CSV writers share the column list.
+static std::vector<std::pair<std::string, std::string>> trialColumns(const TrialRecord& record) {
+    const WorkloadProfile& p = record.profile;
+    const BenchmarkResult& r = record.result;
+    auto num = [](auto value) {
+        std::ostringstream out;
+        out << value;
+        return out.str();
+    };
+
+    std::vector<std::pair<std::string, std::string>> columns = {
+        { "profile", jsonString(p.name) },
+        { "backend", jsonString(backendName(record.backend)) },
+        { "trial", num(record.trial) },
+        { "ops", num(r.ops) },
+        { "warmup_ops", num(p.warmupOps) },
+        { "seed", num(p.seed) },
+        { "add_pct", num(p.addPct) },
+        { "cancel_pct", num(p.cancelPct) },
+        { "modify_pct", num(p.modifyPct) },
+        { "market_pct", num(p.marketPct) },
+        { "ioc_pct", num(p.iocPct) },
+        { "fok_pct", num(p.fokPct) },
+        { "center_price", num(p.centerPrice) },
+        { "spread_half", num(p.spreadHalf) },
+        { "band_width", num(p.bandWidth) },
+        { "modify_range", num(p.modifyRange) },
+        { "size_distribution", jsonString(sizeDistributionName(p.sizeDistribution)) },
+        { "qty_min", num(p.qtyMin) },
+        { "qty_max", num(p.qtyMax) },
+        { "market_qty_scale", num(p.marketQtyScale) },
+        { "immediate_qty_scale", num(p.immediateQtyScale) },
+        { "prefill_orders", num(p.prefillOrders) },
+        { "max_tracked_orders", num(p.maxTrackedOrders) },
+        { "amend_pct", num(p.amendPct) },
+        { "stale_modify_pct", num(p.staleModifyPct) },
+        { "seconds", num(r.seconds) },
+        { "ops_per_sec", num(r.opsPerSec()) },
+        { "adds", num(r.adds) },
+        { "cancels", num(r.cancels) },
+        { "modifies", num(r.modifies) },
+        { "trades", num(r.trades) },
+        { "final_resting_orders", num(r.finalRestingOrders) },
+        { "steady_heap_allocations", num(r.steadyHeapAllocations) },
+        { "steady_pool_chunk_allocations", num(r.steadyPoolChunkAllocations) },
+        { "mean_cancel_ns", num(r.cancels ? r.cancelNanos / r.cancels : 0.0) },
+        { "mean_modify_ns", num(r.modifies ? r.modifyNanos / r.modifies : 0.0) },
+        { "modify_rejects", num(r.modifyRejects) },
+    };
+
+    if constexpr (OrderBook::kStatsEnabled) {
+        auto addHistogram = [&](const std::string& name, const Histogram& histogram) {
+            columns.emplace_back(name + "_p50", num(histogram.percentile(0.50)));
+            columns.emplace_back(name + "_p99", num(histogram.percentile(0.99)));
+            columns.emplace_back(name + "_p999", num(histogram.percentile(0.999)));
+            columns.emplace_back(name + "_max", num(histogram.max()));
+        };
+        addHistogram("add_ns", r.latency.addNanos);
+        addHistogram("cancel_ns", r.latency.cancelNanos);
+        addHistogram("modify_ns", r.latency.modifyNanos);
+        addHistogram("match_ns", r.latency.matchNanos);
+        addHistogram("levels_swept", r.latency.levelsSwept);
+        addHistogram("orders_touched", r.latency.ordersTouched);
+    }
+
+    for (std::size_t i = 0; i < kPerfEventCount; ++i) {
+        const auto event = static_cast<PerfEvent>(i);
+        if (!counted(r, event)) continue;
+        const std::string name = perfEventName(event);
+        columns.emplace_back(name + "_per_op", num(perOp(r.perfPhase, event, r.ops)));
+        if (p.perfCapture == PerfCapture::PER_OP) {
+            columns.emplace_back(name + "_per_add", num(perOp(r.perfAdd, event, r.adds)));
+            columns.emplace_back(name + "_per_cancel", num(perOp(r.perfCancel, event, r.cancels)));
+            columns.emplace_back(name + "_per_modify", num(perOp(r.perfModify, event, r.modifies)));
+        }
+    }
+    return columns;
+}
+
+static void writeJson(const std::string& path, const std::string& label, const std::vector<TrialRecord>& records) {
+    std::ofstream out(path);
+    out << "{\n  \"label\": " << jsonString(label) << ",\n"
+        << "  \"stats_enabled\": " << (OrderBook::kStatsEnabled ? "true" : "false") << ",\n"
+        << "  \"trials\": [";
+    for (std::size_t i = 0; i < records.size(); ++i) {
+        out << (i ? ",\n    {" : "\n    {");
+        const auto columns = trialColumns(records[i]);
+        for (std::size_t c = 0; c < columns.size(); ++c) {
+            out << (c ? ", " : "") << "\"" << columns[c].first << "\": " << columns[c].second;
+        }
+        out << "}";
+    }
+    out << "\n  ]\n}\n";
+    if (!out) throw std::runtime_error("cannot write '" + path + "'");
+}
+
+static void writeCsv(const std::string& path, const std::string& label, const std::vector<TrialRecord>& records) {
+    std::ofstream out(path);
+    for (std::size_t i = 0; i < records.size(); ++i) {
+        const auto columns = trialColumns(records[i]);
+        if (i == 0) {
+            out << "label";
+            for (const auto& column : columns) out << "," << column.first;
+            out << "\n";
+        }
+        out << jsonString(label);
+        for (const auto& column : columns) out << "," << column.second;
+        out << "\n";
+    }
+    if (!out) throw std::runtime_error("cannot write '" + path + "'");
+}
+
+// Runs every trial of one profile on one backend and prints the spread across them.
+// Writes a profile's whole command flow (prefill, warmup and measured ops) as an order-flow
+// file for OrderBookReplay, so later runs stream it without the generator in the timed loop.
+static void recordFlow(const WorkloadProfile& profile, Backend backend, const std::string& path) {
+    WorkloadProfile recorded = profile;
+    recorded.journalPath = path.c_str();
+    const BenchmarkResult result = runBenchmark(configFor(backend, profile), recorded);
+
+    std::cout << "Recorded " << profile.name << ": " << result.journalRecords << " commands to " << path << "\n"
+              << "The first " << result.journalWarmupRecords << " are prefill and warmup: OrderBookReplay " << path
+              << " --warmup " << result.journalWarmupRecords << "\n";
+}
+
+static void runProfileTrials(const WorkloadProfile& profile, Backend backend, unsigned trials, bool verbose,
+    std::vector<TrialRecord>& records) {
+    const OrderBookConfig config = configFor(backend, profile);
+    std::vector<double> rates;
+    const std::size_t first = records.size();
+
+    for (unsigned trial = 0; trial < trials; ++trial) {
+        records.push_back(TrialRecord{ profile, backend, trial, runBenchmark(config, profile) });
+        const BenchmarkResult& result = records.back().result;
+        rates.push_back(result.opsPerSec());
+        if (verbose) {
+            const std::string label = profile.name + " on " + backendName(backend) + ", trial " + std::to_string(trial + 1);
+            printResult(label.c_str(), result, profile.perfCapture);
+        }
+    }
+
+    std::sort(rates.begin(), rates.end());
+    const BenchmarkResult& last = records.back().result;
+    double cancelNanos = 0.0, modifyNanos = 0.0;
+    std::uint64_t cancels = 0, modifies = 0;
+    for (std::size_t i = first; i < records.size(); ++i) {
+        cancelNanos += records[i].result.cancelNanos;
+        modifyNanos += records[i].result.modifyNanos;
+        cancels += records[i].result.cancels;
+        modifies += records[i].result.modifies;
+    }
+
+    std::cout << profile.name << " [" << backendName(backend) << "] x" << trials
+              << " | Ops/sec median " << rates[rates.size() / 2] << " (min " << rates.front() << ", max " << rates.back() << ")"
+              << " | Trades " << last.trades
+              << " | Resting " << last.finalRestingOrders
+              << " | Cancel ns " << (cancels ? cancelNanos / cancels : 0.0)
+              << " | Modify ns " << (modifies ? modifyNanos / modifies : 0.0)
+              << " | Modify rejects " << last.modifyRejects
+              << " | Steady allocs " << last.steadyHeapAllocations << "\n";
+
+    if constexpr (OrderBook::kStatsEnabled) {
+        const OrderBookStats& stats = last.latency;
+        auto line = [](const char* name, const Histogram& histogram) {
+            std::cout << "    " << name << " p50/p99/p99.9/max: " << histogram.percentile(0.50) << "/" << histogram.percentile(0.99)
+                      << "/" << histogram.percentile(0.999) << "/" << histogram.max() << "\n";
+        };
+        line("add ns", stats.addNanos);
+        line("cancel ns", stats.cancelNanos);
+        line("modify ns", stats.modifyNanos);
+        line("match ns", stats.matchNanos);
+    }
+    if (profile.perfCapture != PerfCapture::OFF && !verbose) printPerf(last);
+}
+
+static void printUsage(const char* program) {
+    std::cout
+        << "usage: " << program << " [options]\n"
+        << "With no --profile or --study, runs every named profile on the dense-id book.\n\n"
+        << "  --list                 list profiles and studies\n"
+        << "  --profile NAME|all     profile to run (repeatable)\n"
+        << "  --backend NAME|all     map, ladder or dense (repeatable; default dense)\n"
+        << "  --study NAME|all       run a comparison study (repeatable)\n"
+        << "  --trials N             measured runs per profile and backend (default 3)\n"
+        << "  --verbose              full report for every trial\n"
+        << "  --json FILE, --csv FILE  write one record per trial\n"
+        << "  --label TEXT           tag stored with the results, e.g. a commit id\n"
+        << "  --record FILE          write one profile's command flow for OrderBookReplay instead of timing it\n"
+        << "Profile overrides, applied to every selected profile:\n"
+        << "  --ops N --warmup N --seed N\n"
+        << "  --mix ADD/CANCEL/MODIFY     percentages summing to 100\n"
+        << "  --takers MARKET/IOC/FOK     percent of adds of each kind\n"
+        << "  --center P --spread P --band P --modify-range P\n"
+        << "  --qty-min N --qty-max N --qty-dist uniform|log-uniform\n"
+        << "  --market-scale N --immediate-scale N   size multiplier for market / IOC and FOK orders\n"
+        << "  --prefill N --max-tracked N --amend PCT --stale-modify PCT\n"
+        << "  --perf                      hardware counters per op over the measured phase\n"
+        << "  --perf-ops                  same, plus a split by op type (reads counters around every call)\n";
+}
+
+static void printList() {
+    std::cout << "Profiles:\n";
+    for (const WorkloadProfile& profile : namedProfiles()) {
+        std::cout << "  " << profile.name << ": " << profile.description << "\n";
+    }
+    std::cout << "Studies:\n";
+    for (const Study& study : studies()) {
+        std::cout << "  " << study.name << ": " << study.description << "\n";
+    }
+}
+
+static void validateProfile(const WorkloadProfile& profile) {
+    auto fail = [&](const std::string& what) { throw std::invalid_argument("profile " + profile.name + ": " + what); };
+    if (profile.addPct < 0 || profile.cancelPct < 0 || profile.modifyPct < 0 || profile.addPct + profile.cancelPct + profile.modifyPct != 100) {
+        fail("add/cancel/modify percentages must sum to 100");
+    }
+    if (profile.marketPct < 0 || profile.iocPct < 0 || profile.fokPct < 0 || profile.marketPct + profile.iocPct + profile.fokPct > 100) {
+        fail("market/ioc/fok percentages must sum to at most 100");
+    }
+    if (profile.qtyMin == 0 || profile.qtyMin > profile.qtyMax || profile.marketQtyScale == 0 || profile.immediateQtyScale == 0) fail("bad order size range");
+    if (profile.spreadHalf < 0 || profile.bandWidth < 0 || profile.modifyRange < 0) fail("price band sizes must be non-negative");
+    if (profile.amendPct < 0 || profile.amendPct > 100 || profile.staleModifyPct < 0 || profile.staleModifyPct > 100) {
+        fail("amend and stale-modify percentages must be within 0..100");
+    }
+    if (profile.numOps == 0) fail("needs at least one measured op");
+}
+
+int main(int argc, char** argv) {
+    using Override = std::function<void(WorkloadProfile&)>;
+
+    std::vector<std::string> profileNames;
+    std::vector<Backend> backends;
+    std::vector<std::string> studyNames;
+    std::vector<Override> overrides;
+    unsigned trials = 3;
+    bool verbose = false;
+    std::string jsonPath;
+    std::string csvPath;
+    std::string label;
+    std::string recordPath;
+
+    try {
+        for (int i = 1; i < argc; ++i) {
+            const std::string arg = argv[i];
+            auto value = [&]() -> std::string {
+                if (i + 1 >= argc) throw std::invalid_argument(arg + " needs a value");
+                return argv[++i];
+            };
+            auto integer = [&]() { return std::stoll(value()); };
+            auto percentages = [&](int (&out)[3]) {
+                const std::string text = value();
+                char sep1 = 0, sep2 = 0;
+                std::istringstream in(text);
+                if (!(in >> out[0] >> sep1 >> out[1] >> sep2 >> out[2]) || sep1 != '/' || sep2 != '/') {
+                    throw std::invalid_argument(arg + " expects A/B/C, got " + text);
+                }
+            };
+
+            if (arg == "--help" || arg == "-h") {
+                printUsage(argv[0]);
+                return 0;
+            } else if (arg == "--list") {
+                printList();
+                return 0;
+            } else if (arg == "--profile") {
+                profileNames.push_back(value());
+            } else if (arg == "--backend") {
+                const std::string name = value();
+                if (name == "map" || name == "all") backends.push_back(Backend::MAP);
+                if (name == "ladder" || name == "all") backends.push_back(Backend::LADDER);
+                if (name == "dense" || name == "all") backends.push_back(Backend::DENSE_IDS);
+                if (name != "map" && name != "ladder" && name != "dense" && name != "all") throw std::invalid_argument("unknown backend " + name);
+            } else if (arg == "--study") {
+                studyNames.push_back(value());
+            } else if (arg == "--trials") {
+                trials = static_cast<unsigned>(std::max(1LL, integer()));
+            } else if (arg == "--verbose") {
+                verbose = true;
+            } else if (arg == "--json") {
+                jsonPath = value();
+            } else if (arg == "--csv") {
+                csvPath = value();
+            } else if (arg == "--label") {
+                label = value();
+            } else if (arg == "--record") {
+                recordPath = value();
+            } else if (arg == "--ops") {
+                const auto n = static_cast<std::uint64_t>(integer());
+                overrides.push_back([n](WorkloadProfile& p) { p.numOps = n; });
+            } else if (arg == "--warmup") {
+                const auto n = static_cast<std::uint64_t>(integer());
+                overrides.push_back([n](WorkloadProfile& p) { p.warmupOps = n; });
+            } else if (arg == "--seed") {
+                const auto n = static_cast<std::uint64_t>(std::stoull(value(), nullptr, 0));
+                overrides.push_back([n](WorkloadProfile& p) { p.seed = n; });
+            } else if (arg == "--mix") {
+                int mix[3];
+                percentages(mix);
+                overrides.push_back([=](WorkloadProfile& p) { p.addPct = mix[0]; p.cancelPct = mix[1]; p.modifyPct = mix[2]; });
+            } else if (arg == "--takers") {
+                int takers[3];
+                percentages(takers);
+                overrides.push_back([=](WorkloadProfile& p) { p.marketPct = takers[0]; p.iocPct = takers[1]; p.fokPct = takers[2]; });
+            } else if (arg == "--center") {
+                const Price n = integer();
+                overrides.push_back([n](WorkloadProfile& p) { p.centerPrice = n; });
+            } else if (arg == "--spread") {
+                const Price n = integer();
+                overrides.push_back([n](WorkloadProfile& p) { p.spreadHalf = n; });
+            } else if (arg == "--band") {
+                const Price n = integer();
+                overrides.push_back([n](WorkloadProfile& p) { p.bandWidth = n; });
+            } else if (arg == "--modify-range") {
+                const Price n = integer();
+                overrides.push_back([n](WorkloadProfile& p) { p.modifyRange = n; });
+            } else if (arg == "--qty-min") {
+                const auto n = static_cast<Quantity>(integer());
+                overrides.push_back([n](WorkloadProfile& p) { p.qtyMin = n; });
+            } else if (arg == "--qty-max") {
+                const auto n = static_cast<Quantity>(integer());
+                overrides.push_back([n](WorkloadProfile& p) { p.qtyMax = n; });
+            } else if (arg == "--qty-dist") {
+                const std::string name = value();
+                if (name != "uniform" && name != "log-uniform") throw std::invalid_argument("unknown size distribution " + name);
+                const SizeDistribution distribution = name == "uniform" ? SizeDistribution::UNIFORM : SizeDistribution::LOG_UNIFORM;
+                overrides.push_back([distribution](WorkloadProfile& p) { p.sizeDistribution = distribution; });
+            } else if (arg == "--market-scale") {
+                const auto n = static_cast<Quantity>(integer());
+                overrides.push_back([n](WorkloadProfile& p) { p.marketQtyScale = n; });
+            } else if (arg == "--immediate-scale") {
+                const auto n = static_cast<Quantity>(integer());
+                overrides.push_back([n](WorkloadProfile& p) { p.immediateQtyScale = n; });
+            } else if (arg == "--prefill") {
+                const auto n = static_cast<std::uint64_t>(integer());
+                overrides.push_back([n](WorkloadProfile& p) { p.prefillOrders = n; });
+            } else if (arg == "--max-tracked") {
+                const auto n = static_cast<std::size_t>(integer());
+                overrides.push_back([n](WorkloadProfile& p) { p.maxTrackedOrders = n; });
+            } else if (arg == "--perf" || arg == "--perf-ops") {
+                const PerfCapture capture = arg == "--perf" ? PerfCapture::PHASE : PerfCapture::PER_OP;
+                overrides.push_back([capture](WorkloadProfile& p) { p.perfCapture = capture; });
+            } else if (arg == "--amend") {
+                const int n = static_cast<int>(integer());
+                overrides.push_back([n](WorkloadProfile& p) { p.amendPct = n; });
+            } else if (arg == "--stale-modify") {
+                const int n = static_cast<int>(integer());
+                overrides.push_back([n](WorkloadProfile& p) { p.staleModifyPct = n; });
+            } else {
+                throw std::invalid_argument("unknown option " + arg);
+            }
+        }
+
+        if (profileNames.empty() && studyNames.empty()) profileNames.push_back("all");
+        if (backends.empty()) backends.push_back(Backend::DENSE_IDS);
+
+        std::vector<WorkloadProfile> selected;
+        const std::vector<WorkloadProfile> available = namedProfiles();
+        for (const std::string& name : profileNames) {
+            auto match = std::find_if(available.begin(), available.end(), [&](const auto& p) { return p.name == name; });
+            if (name == "all") selected.insert(selected.end(), available.begin(), available.end());
+            else if (match != available.end()) selected.push_back(*match);
+            else throw std::invalid_argument("unknown profile " + name + " (see --list)");
+        }
+        for (WorkloadProfile& profile : selected) {
+            for (const Override& apply : overrides) apply(profile);
+            validateProfile(profile);
+        }
+
+        std::vector<Study> chosenStudies;
+        const std::vector<Study> allStudies = studies();
+        for (const std::string& name : studyNames) {
+            auto match = std::find_if(allStudies.begin(), allStudies.end(), [&](const auto& s) { return name == s.name; });
+            if (name == "all") chosenStudies.insert(chosenStudies.end(), allStudies.begin(), allStudies.end());
+            else if (match != allStudies.end()) chosenStudies.push_back(*match);
+            else throw std::invalid_argument("unknown study " + name + " (see --list)");
+        }
+
+        if (!recordPath.empty()) {
+            if (selected.size() != 1 || !chosenStudies.empty()) throw std::invalid_argument("--record takes exactly one profile");
+            recordFlow(selected.front(), backends.front(), recordPath);
+            return 0;
+        }
+
+        std::vector<TrialRecord> records;
+        if (!selected.empty()) {
+            std::cout << "SUITE (" << trials << " trials per profile and backend"
+                      << (OrderBook::kStatsEnabled ? ", book latency histograms on" : "") << ")\n";
+        }
+        for (const WorkloadProfile& profile : selected) {
+            for (const Backend backend : backends) runProfileTrials(profile, backend, trials, verbose, records);
+        }
+        if (!selected.empty()) std::cout << "\n";
+
+        if (!jsonPath.empty()) writeJson(jsonPath, label, records);
+        if (!csvPath.empty()) writeCsv(csvPath, label, records);
+
+        for (const Study& study : chosenStudies) study.run();
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        printUsage(argv[0]);
+        return 2;
+    }
 
     return 0;
 }
@@ -0,0 +1,101 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "feedBook.h"
+#include "histogram.h"
+#include "marketDataRing.h"
+
+// Follows a market data ring from another process and rebuilds the book from it.
+//   OrderBookFeedReader <name> [--oldest] [--levels N] [--every-ms N]
+// The writer is e.g. `OrderBookReplay <flow> --publish <name>`. The reader prints the top of its
+// rebuilt book every N ms while records arrive, and a summary once the writer closes the ring.
+
+static void usage(const char* program) {
+    std::cerr << "usage: " << program << " <name> [--oldest] [--levels N] [--every-ms N]\n";
+}
+
+static void printTop(const FeedBook& book, const MarketDataReader& reader, std::size_t levels) {
+    std::cout << "Records: " << book.getRecordCount() << " | Lost: " << reader.getLost() << " | Resting orders: " << book.getOrderCount()
+              << " | Trades: " << book.getTradeCount() << "\n";
+    for (const auto& level : book.getAskDepth(levels)) std::cout << "  ask " << level.price << " x " << level.volume << "\n";
+    for (const auto& level : book.getBidDepth(levels)) std::cout << "  bid " << level.price << " x " << level.volume << "\n";
+}
+
+static int follow(const std::string& name, MarketDataReader::Start start, std::size_t levels, std::chrono::milliseconds every) {
+    using Clock = std::chrono::steady_clock;
+
+    MarketDataReader reader(name, start);
+    FeedBook book;
+    Histogram latencyNanos;
+    const double nanosPerTick = latency_clock::nanosPerTick();
+
+    MarketDataRecord record;
+    auto nextPrint = Clock::now() + every;
+    std::uint64_t idle = 0;
+    for (;;) {
+        const MarketDataRead status = reader.poll(record);
+        if (status == MarketDataRead::RECORD) {
+            idle = 0;
+            book.apply(record);
+            const std::uint64_t now = latency_clock::now();
+            if (now > record.publishedTicks) latencyNanos.record(static_cast<std::uint64_t>(static_cast<double>(now - record.publishedTicks) * nanosPerTick));
+        } else if (status == MarketDataRead::OVERRUN) {
+            std::cout << "Overrun: skipped to record " << reader.getNextSequence() << " (" << reader.getLost()
+                      << " lost so far); the rebuilt book is incomplete from here\n";
+        } else {
+            if (reader.isFinished()) break;
+            // Spin briefly, then stop burning the core the writer may need.
+            if (++idle > 1000) std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+
+        if (every.count() > 0 && Clock::now() >= nextPrint) {
+            printTop(book, reader, levels);
+            nextPrint = Clock::now() + every;
+        }
+    }
+
+    std::cout << "Writer closed\n";
+    printTop(book, reader, levels);
+    std::cout << "Traded volume: " << book.getTradedVolume() << "\n"
+              << "Records for unknown orders: " << book.getUnknownOrderRecords() << "\n"
+              << "Order-by-order depth matches L2 feed: " << (book.matchesLevels() ? "yes" : "NO") << "\n"
+              << "Publish-to-read latency ns: p50=" << latencyNanos.percentile(0.50) << " p99=" << latencyNanos.percentile(0.99)
+              << " max=" << latencyNanos.max() << "\n";
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    try {
+        MarketDataReader::Start start = MarketDataReader::Start::LATEST;
+        std::size_t levels = 5;
+        std::chrono::milliseconds every{ 1000 };
+        for (int i = 2; i < argc; ++i) {
+            const bool hasValue = i + 1 < argc;
+            if (std::strcmp(argv[i], "--oldest") == 0) {
+                start = MarketDataReader::Start::OLDEST;
+            } else if (std::strcmp(argv[i], "--levels") == 0 && hasValue) {
+                levels = std::strtoull(argv[++i], nullptr, 10);
+            } else if (std::strcmp(argv[i], "--every-ms") == 0 && hasValue) {
+                every = std::chrono::milliseconds(std::strtoll(argv[++i], nullptr, 10));
+            } else {
+                usage(argv[0]);
+                return 2;
+            }
+        }
+        return follow(argv[1], start, levels, every);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+}
@@ -115,7 +115,8 @@ int main() {
         Order order(id, side, type, price, qty, tif);
 
         // EXECUTE
-        auto trades = orderBook.addOrder(order);
+        std::vector<Trade> trades;
+        orderBook.addOrder(order, trades);
 
         // TRACKING (Only if GTC and not filled)
         if (type == OrderType::LIMIT && tif == TimeInForce::GTC && !order.isFilled()) {
@@ -134,13 +135,11 @@ int main() {
         size_t idx = idxDist(rng);
         OrderId id = activeOrderIds[idx];
 
-        // EXECUTE
-        bool success = orderBook.cancelOrder(id);
+        // EXECUTE (a rejected cancel means the order already filled)
+        orderBook.cancelOrder(id);
 
-        // Remove from tracking
+        // Remove from tracking either way
         activeOrderIds.erase(activeOrderIds.begin() + idx);
-
-        //if (success) std::cout << "[CANCEL] ID:" << id << " Success\n";
     };
 
     auto modifyOrder = [&]() {
@@ -154,17 +153,13 @@ int main() {
 
         OrderModify mod{ id, newPrice, newQty };
 
-        try {
-            // EXECUTE
-            auto trades = orderBook.modifyOrder(mod);
-            //std::cout << "[MODIFY] ID:" << id << " NewPrice:" << newPrice << " NewQty:" << newQty << "\n";
-
-            // If filled, remove from active list
-            if (!trades.empty()) {
-                activeOrderIds.erase(activeOrderIds.begin() + idx);
-            }
-        } catch (...) {
-            // Order likely already filled or gone
+        // EXECUTE
+        std::vector<Trade> trades;
+        const OrderResult result = orderBook.modifyOrder(mod, trades);
+        //std::cout << "[MODIFY] ID:" << id << " NewPrice:" << newPrice << " NewQty:" << newQty << "\n";
+
+        // Already filled or gone, or filled by the modify: remove from active list
+        if (!result.resting) {
             activeOrderIds.erase(activeOrderIds.begin() + idx);
         }
        };
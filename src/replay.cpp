@@ -0,0 +1,148 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <string>
+
+#include "journal.h"
+#include "marketDataRing.h"
+#include "orderFlow.h"
+
+// Streams recorded order flow (a command journal) through a book and reports how fast it ran.
+//   OrderBookReplay <flow> [--warmup N] [--ladder-base N --ladder-ticks N] [--dense-ids] [--levels N] [--publish NAME]
+//   OrderBookReplay convert <in.csv> <out.flow>
+//   OrderBookReplay dump <flow> [out.csv]
+// The ladder/id-index options only affect replay speed, never the resulting book. Synthetic
+// flow files come from `OrderBookBenchmark --profile NAME --record FILE`. --publish streams the
+// book's order events and level updates into a shared-memory ring for `OrderBookFeedReader NAME`,
+// waiting for Enter first so a reader can attach.
+
+static void usage(const char* program) {
+    std::cerr << "usage: " << program << " <flow> [--warmup N] [--ladder-base N --ladder-ticks N] [--dense-ids] [--levels N] [--publish NAME]\n"
+              << "       " << program << " convert <in.csv> <out.flow>\n"
+              << "       " << program << " dump <flow> [out.csv]\n";
+}
+
+static int convert(const std::string& csvPath, const std::string& flowPath) {
+    std::ifstream in(csvPath);
+    if (!in) throw std::runtime_error("cannot open '" + csvPath + "'");
+
+    JournalWriter journal(flowPath);
+    const std::uint64_t written = convertCsvToJournal(in, journal);
+    journal.close();
+    std::cout << "Wrote " << written << " commands to " << flowPath << "\n";
+    return 0;
+}
+
+static int dump(const std::string& flowPath, const char* csvPath) {
+    JournalReader reader(flowPath);
+    if (!csvPath) {
+        writeJournalCsv(std::cout, reader.records());
+        return 0;
+    }
+
+    std::ofstream out(csvPath);
+    if (!out) throw std::runtime_error(std::string("cannot open '") + csvPath + "'");
+    writeJournalCsv(out, reader.records());
+    return 0;
+}
+
+static int replay(const std::string& path, const OrderBookConfig& config, std::size_t warmup, std::size_t levels, const char* feedName) {
+    JournalReader reader(path);
+    OrderBook book(config);
+
+    std::optional<MarketDataPublisher> feed;
+    if (feedName) {
+        feed.emplace(feedName);
+        feed->attach(book);
+        std::cout << "Publishing to " << feedName << "; press Enter to start" << std::endl;
+        std::cin.get();
+    }
+
+    const auto records = reader.records();
+    if (warmup > records.size()) warmup = records.size();
+
+    std::uint64_t trades = 0;
+    auto countTrades = [&trades](const Trade&) { ++trades; };
+    replayJournal(book, records.first(warmup), countTrades);
+    trades = 0;
+
+    const auto start = std::chrono::steady_clock::now();
+    const std::uint64_t applied = replayJournal(book, records.subspan(warmup), countTrades);
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "Records: " << records.size() << " (warmup " << warmup << ", timed " << records.size() - warmup
+              << ", applied " << applied << ")\n"
+              << "Seconds: " << seconds << "\n"
+              << "Replay ops/sec: " << (seconds > 0.0 ? static_cast<double>(applied) / seconds : 0.0) << "\n"
+              << "Trades: " << trades << "\n"
+              << "Resting orders: " << book.getOrderCount() << "\n";
+    if (feed) {
+        feed->detach(book);
+        feed->close();
+        std::cout << "Records published: " << feed->getPublished() << "\n";
+    }
+
+    if (auto bid = book.getBestBid()) std::cout << "Best bid: " << *bid << "\n";
+    if (auto ask = book.getBestAsk()) std::cout << "Best ask: " << *ask << "\n";
+
+    for (const auto& level : book.getAskDepth(levels)) std::cout << "  ask " << level.price << " x " << level.volume << "\n";
+    for (const auto& level : book.getBidDepth(levels)) std::cout << "  bid " << level.price << " x " << level.volume << "\n";
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    try {
+        if (std::strcmp(argv[1], "convert") == 0) {
+            if (argc != 4) {
+                usage(argv[0]);
+                return 2;
+            }
+            return convert(argv[2], argv[3]);
+        }
+        if (std::strcmp(argv[1], "dump") == 0) {
+            if (argc != 3 && argc != 4) {
+                usage(argv[0]);
+                return 2;
+            }
+            return dump(argv[2], argc == 4 ? argv[3] : nullptr);
+        }
+
+        OrderBookConfig config;
+        std::size_t warmup = 0;
+        std::size_t levels = 5;
+        const char* feedName = nullptr;
+        for (int i = 2; i < argc; ++i) {
+            const bool hasValue = i + 1 < argc;
+            if (std::strcmp(argv[i], "--ladder-base") == 0 && hasValue) {
+                config.ladderBase = std::strtoll(argv[++i], nullptr, 10);
+            } else if (std::strcmp(argv[i], "--ladder-ticks") == 0 && hasValue) {
+                config.ladderTicks = std::strtoull(argv[++i], nullptr, 10);
+            } else if (std::strcmp(argv[i], "--warmup") == 0 && hasValue) {
+                warmup = std::strtoull(argv[++i], nullptr, 10);
+            } else if (std::strcmp(argv[i], "--levels") == 0 && hasValue) {
+                levels = std::strtoull(argv[++i], nullptr, 10);
+            } else if (std::strcmp(argv[i], "--publish") == 0 && hasValue) {
+                feedName = argv[++i];
+            } else if (std::strcmp(argv[i], "--dense-ids") == 0) {
+                config.idIndex = IdIndexKind::DENSE_WINDOW;
+            } else {
+                usage(argv[0]);
+                return 2;
+            }
+        }
+        return replay(argv[1], config, warmup, levels, feedName);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+}